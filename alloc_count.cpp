@@ -0,0 +1,68 @@
+#include "alloc_count.h"
+
+#ifdef XORGCAL_COUNT_ALLOC
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> alloc_counter{0};
+
+size_t alloc_count()
+{
+	return alloc_counter.load(std::memory_order_relaxed);
+}
+
+static void* counted_alloc(size_t size)
+{
+	alloc_counter.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = counted_alloc(size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = counted_alloc(size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return counted_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+#endif  // XORGCAL_COUNT_ALLOC
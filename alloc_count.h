@@ -0,0 +1,37 @@
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+// Instrumentation build (-DXORGCAL_COUNT_ALLOC, "make COUNT_ALLOC=1"):
+// global operator new is replaced and counted, so code paths can show
+// they run without heap allocation. malloc() inside Xlib/Xft is not counted.
+// alloc_count.cpp is linked into executables only, never into libxorgcal:
+// replacing operator new is the program's choice, not the library's.
+
+#include <cstddef>
+#include <cstdio>
+
+#ifdef XORGCAL_COUNT_ALLOC
+// operator new calls since program start, all threads.
+// Weak: nullptr if the program is linked without alloc_count.cpp.
+size_t alloc_count() __attribute__((weak));
+
+// Prints the allocations made during its lifetime on every exit of the scope,
+// errors and exceptions included.
+struct alloc_report_t
+{
+	explicit alloc_report_t(const char* name)
+	: name_(name)
+	, start_(alloc_count ? alloc_count() : 0)
+	{}
+	~alloc_report_t()
+	{
+		if (alloc_count)
+			fprintf(stderr, "heap allocations in %s: %zu\n", name_, alloc_count() - start_);
+	}
+
+	const char* name_;
+	size_t start_;
+};
+#endif
+
+#endif  // ALLOC_COUNT_H
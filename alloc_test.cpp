@@ -0,0 +1,215 @@
+// Built with -DXORGCAL_COUNT_ALLOC -DXORGCAL_FAKE_SCREEN: a whole session run
+// (target loop, touch parsing, solvers, quality report, callbacks) and output
+// formatting shall not allocate after startup. The headless screen touches
+// every target, see screen_fake.h.
+
+#include "xorgcal.h"
+#include "alloc_count.h"
+#include "calibration.h"
+#include "calibration_quality.h"
+#include "evdev_device.h"
+#include "screen_x11.h"
+#include "text_buf.h"
+#include "transform_matrix.h"
+#include "xorg_conf.h"
+#include "log.h"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+constexpr int runs = 20;
+
+// Calls of the session callbacks, formatted without allocation.
+struct session_count_t
+{
+	int samples;
+	int reports;
+};
+
+void sample_count(int, int, int, void* user)
+{
+	++static_cast<session_count_t*>(user)->samples;
+}
+
+void report_count(const char* json, void* user)
+{
+	ASSERT(json[0] == '{');
+	++static_cast<session_count_t*>(user)->reports;
+}
+
+void text_ignore(const char* text, void*)
+{
+	ASSERT(strlen(text) > 0);
+}
+
+bool near(float a, float b)
+{
+	return std::fabs(a - b) < 1e-3;
+}
+
+// Allocations of runs session runs after the first one. matrix of the last run.
+size_t session_allocs(const xorgcal_options_t& options, float matrix[9], session_count_t& count)
+{
+	// not dereferenced by the fake screen
+	static char display_dummy;
+	xorgcal_session_t* session = xorgcal_session_new(reinterpret_cast<Display*>(&display_dummy), &options);
+	ASSERT(session != nullptr);
+	xorgcal_callbacks_t callbacks;
+	xorgcal_callbacks_init(&callbacks);
+	callbacks.sample_accepted = sample_count;
+	callbacks.quality_report = report_count;
+	// first run: lazy initialization (e.g. stdio buffers) is startup
+	ASSERT(xorgcal_session_run(session, &callbacks, &count, matrix) == XORGCAL_OK);
+	size_t start = alloc_count();
+	for (int idx = 0; idx < runs; ++idx)
+		ASSERT(xorgcal_session_run(session, &callbacks, &count, matrix) == XORGCAL_OK);
+	size_t allocs = alloc_count() - start;
+	xorgcal_session_free(session);
+	return allocs;
+}
+
+void session_test()
+{
+	screen_fake_config_t& panel = screen_x11_t::config();
+	float matrix[9];
+
+	// 4 targets, panel off by a sub-pixel offset
+	panel.panel_offset = touch_xy_t{3.5, -2.25};
+	xorgcal_options_t options;
+	xorgcal_options_init(&options);
+	options.max_error_px = 1;   // exact touches pass, no retry
+	session_count_t count{};
+	ASSERT(session_allocs(options, matrix, count) == 0);
+	ASSERT(count.samples == 4 * (runs + 1) && count.reports == runs + 1);
+	ASSERT(near(matrix[0], 1) && near(matrix[2], -3.5 / 1920));
+
+	// 4 x 4 grid, least squares
+	options.grid = 4;
+	count = session_count_t{};
+	ASSERT(session_allocs(options, matrix, count) == 0);
+	ASSERT(count.samples == 16 * (runs + 1));
+
+	// adaptive placement: target loop with a solve and a report per target
+	options.grid = 2;
+	options.adaptive = 1;
+	options.tolerance_px = 0;   // never reached: all max_targets
+	options.max_targets = 9;
+	count = session_count_t{};
+	ASSERT(session_allocs(options, matrix, count) == 0);
+	ASSERT(count.samples == 9 * (runs + 1) && count.reports == (9 - 3) * (runs + 1));
+
+	// all targets at once on a panel with inverted X: matched through the reference fit
+	options.adaptive = 0;
+	options.grid = 3;
+	options.multitouch = 1;
+	panel.panel_scale = touch_xy_t{-1, 1};
+	panel.panel_offset = touch_xy_t{1920, 0};
+	count = session_count_t{};
+	ASSERT(session_allocs(options, matrix, count) == 0);
+	ASSERT(count.samples == 9 * (runs + 1));
+	ASSERT(near(matrix[0], -1) && near(matrix[2], 1) && near(matrix[4], 1));
+
+	panel.panel_scale = touch_xy_t{1, 1};
+	panel.panel_offset = touch_xy_t{0, 0};
+}
+
+// Touch parsing of the evdev backend and the texts written after the session.
+void output_test()
+{
+	evdev_device_t device{};
+	device.x = evdev_axis_t{ABS_X, 0, 4095};
+	device.y = evdev_axis_t{ABS_Y, 0, 4095};
+	transform_matrix_t matr{1.02f, 0.01f, -0.01f, -0.02f, 0.98f, 0.015f, 0, 0, 1};
+	float matrix[9];
+	std::copy(matr.begin(), matr.end(), matrix);
+	std::array<char, 2048> conf_storage;
+	char path[] = "/tmp/alloc_test.XXXXXX";
+	int fd = mkstemp(path);
+	ASSERT(fd >= 0);
+	close(fd);
+	xorgcal_conf_device_t devices[2] = {
+		{"eGalax Inc. USB TouchController", {}},
+		{"ILITEK Multi-Touch", {}},
+	};
+	std::copy(matr.begin(), matr.end(), devices[0].matrix);
+	std::copy(matr.begin(), matr.end(), devices[1].matrix);
+	std::array<char, 1024> quality_storage;
+	text_buf_t quality(quality_storage);
+	calibration_quality_t score{};
+	score.count = 1;
+	ASSERT(calibration_quality_json(score, quality));
+	quality.append("\n");
+	ASSERT(calibration_quality_json(score, quality));
+	quality.append("\n");
+	std::array<char, 4096> seat_storage;
+
+	auto work = [&]() {
+		input_event events[] = {
+			{{}, EV_KEY, BTN_TOUCH, 1},
+			{{}, EV_ABS, ABS_X, 1000},
+			{{}, EV_ABS, ABS_Y, 3000},
+			{{}, EV_SYN, SYN_REPORT, 0},
+			{{}, EV_KEY, BTN_TOUCH, 0},
+			{{}, EV_SYN, SYN_REPORT, 0},
+		};
+		evdev_touch_t touch{};
+		int touches = 0;
+		for (const auto& event : events)
+			touches += evdev_event(device, event, 1920, 1080, touch);
+		ASSERT(touches == 1);
+
+		text_buf_t conf(conf_storage);
+		ASSERT(xorg_str(matr, "eGalax Inc. USB TouchController", conf));
+		ASSERT(xinput_str(matr, "eGalax Inc. USB TouchController", conf));
+		ASSERT(transform_matrix_str(matr, conf));
+		ASSERT(xorgcal_xorg_conf(matrix, "eGalax Inc. USB TouchController", text_ignore, nullptr) == XORGCAL_OK);
+		ASSERT(xorgcal_xorg_conf_update(path, devices, 2) == XORGCAL_OK);
+		// multiseat report: two seats appended, attempts as array items
+		seat_storage[0] = '\0';
+		ASSERT(xorgcal_seat_report(":0", "eGalax \"A\"", 1, matrix, quality.c_str(),
+			seat_storage.data(), seat_storage.size()) == XORGCAL_OK);
+		ASSERT(xorgcal_seat_report(":1", "ILITEK", 0, matrix, "",
+			seat_storage.data(), seat_storage.size()) == XORGCAL_OK);
+		ASSERT(strstr(seat_storage.data(), "\"device\":\"eGalax \\\"A\\\"\"") != nullptr);
+		ASSERT(strstr(seat_storage.data(), "\"attempts\":[{\"targets\"") != nullptr);
+		ASSERT(strstr(seat_storage.data(), "}]}{\"display\":\":1\"") != nullptr);
+		ASSERT(strstr(seat_storage.data(), "\"ok\":false,") != nullptr);
+		ASSERT(strstr(seat_storage.data(), "\"attempts\":[]}") != nullptr);
+	};
+	work();
+	size_t start = alloc_count();
+	for (int idx = 0; idx < runs; ++idx)
+		work();
+	size_t allocs = alloc_count() - start;
+	printf("heap allocations in %d output runs: %zu\n", runs, allocs);
+	ASSERT(allocs == 0);
+	ASSERT(unlink(path) == 0);
+
+	// truncation is reported, not overrun
+	std::array<char, 16> small;
+	text_buf_t small_buf(small);
+	ASSERT(!xorg_str(transform_matrix_identity(), "device", small_buf));
+	ASSERT(small_buf.length() == small.size() - 1);
+	small[0] = '\0';
+	ASSERT(xorgcal_seat_report(":0", "device", 1, matrix, "", small.data(), small.size()) == XORGCAL_ERROR);
+	ASSERT(strlen(small.data()) == small.size() - 1);
+}
+
+int main()
+{
+	// counter works
+	size_t start = alloc_count();
+	std::string heap(100, 'x');
+	ASSERT(alloc_count() > start);
+
+	session_test();
+	output_test();
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,339 @@
+#include "calibration.h"
+#include "target_placement.h"
+#include "log.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+void draw_touch_point(screen_x11_t& scr, xy_t xy, color_index_t color_index)
+{
+	scr.target(xy, cross_size, color_index);
+}
+
+void draw_message(screen_x11_t& scr, const std::vector<std::string>& str_list)
+{
+	int max_width = -1;
+	for (const auto& str : str_list)
+		max_width = std::max(max_width, scr.text_width(str.c_str()));
+	int line_spacing = scr.text_height() / 2;
+	int height = str_list.size() * (scr.text_height() + line_spacing);
+	int rect_offset = scr.text_height();
+	xy_t xy{};
+	xy.x = (scr.width_ / 2) - (max_width / 2);
+	xy.y = (scr.height_ / 2) - (height / 2);
+	rect_t rect{
+		{
+			(scr.width_ / 2) - ((max_width + rect_offset) / 2),
+			(scr.height_ / 2) - ((height + rect_offset) / 2)
+		},
+		{xy.x + max_width + rect_offset, xy.y + height + rect_offset}
+	};
+	scr.rect(rect, BLACK);
+
+	for(int idx = 0; idx < str_list.size(); ++idx)
+	{
+		scr.text(
+			{
+				(scr.width_ / 2) - (scr.text_width(str_list[idx].c_str()) / 2),
+				xy.y + ((idx + 1) * (scr.text_height() + line_spacing))
+			},
+			str_list[idx].c_str());
+	}
+}
+
+// Milliseconds from kernel timestamp of the touch, evdev clock is CLOCK_MONOTONIC.
+static double evdev_age_ms(const evdev_touch_t& touch)
+{
+	timespec now{};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - touch.time.tv_sec) * 1e3 + (now.tv_nsec / 1e3 - touch.time.tv_usec) / 1e3;
+}
+
+bool wait_touch_or_key(screen_x11_t& scr, evdev_device_t* evdev, touch_xy_t& xy, size_t timeout_s)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_s);
+	for (;;)
+	{
+		unsigned int keycode;
+		// with evdev X button events are the same touches, only keys count
+		if (scr.get_touch_button_event(xy, keycode) && evdev == nullptr)
+		{
+			LOG("%.2f:%.2f", xy.x, xy.y);
+			return true;
+		}
+		else
+			if (keycode != 0)
+				return false;
+		if (evdev != nullptr)
+		{
+			evdev_touch_t touch{};
+			int rc = evdev_touch_wait(*evdev, scr.width_, scr.height_, touch, 0);
+			if (rc < 0)
+				return false;
+			if (rc > 0)
+			{
+				xy = touch.xy;
+				LOG("evdev %.2f:%.2f raw: %d:%d age: %.3f ms", xy.x, xy.y, touch.raw.x, touch.raw.y, evdev_age_ms(touch));
+				return true;
+			}
+		}
+		int left_ms = -1;
+		if (timeout_s != 0)
+		{
+			left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now()).count();
+			if (left_ms <= 0)
+				break;
+		}
+		// sleeps until input or the next animation frame
+		scr.wait(evdev != nullptr ? evdev->fd : -1, left_ms);
+	}
+	ERR("timeout %zu sec. is over", timeout_s);
+	return false;
+}
+
+bool get_touch_point(screen_x11_t& scr, evdev_device_t* evdev, size_t idx, touch_point_t& touch_point,
+	const touch_point_t* prev, size_t timeout_s, const xorgcal_callbacks_t* callbacks, void* user)
+{
+	draw_touch_point(scr, touch_point.point, RED);
+	if (prev != nullptr)
+		draw_touch_point(scr, prev->point, WHITE);
+	scr.ring_start(touch_point.point, cross_size);
+	LOG("target shown %zu: %d:%d", idx, touch_point.point.x, touch_point.point.y);
+	if (callbacks && callbacks->target_shown)
+		callbacks->target_shown(idx, touch_point.point.x, touch_point.point.y, user);
+
+	touch_xy_t xy;
+	bool touched = wait_touch_or_key(scr, evdev, xy, timeout_s);
+	scr.ring_stop();
+	if (!touched)
+		return false;
+	touch_point.touch = xy;
+	xy_t pixel = xy_round(xy);
+	scr.disc(pixel, 4, BLUE);
+	LOG("sample accepted %zu: %.2f:%.2f", idx, xy.x, xy.y);
+	if (callbacks && callbacks->sample_accepted)
+		callbacks->sample_accepted(idx, pixel.x, pixel.y, user);
+	return true;
+}
+
+bool get_touch_point_list(screen_x11_t& scr, evdev_device_t* evdev, touch_point_list_t& touch_point_list,
+	size_t timeout_s, const xorgcal_callbacks_t* callbacks, void* user)
+{
+	for (size_t idx = 0; idx < touch_point_list.size(); ++idx)
+		if (!get_touch_point(scr, evdev, idx, touch_point_list[idx],
+			idx > 0 ? &touch_point_list[idx - 1] : nullptr, timeout_s, callbacks, user))
+			return false;
+	return true;
+}
+
+// Touch held on a target, accepted at its begin position when lifted.
+struct contact_track_t
+{
+	int touch_id;
+	size_t target;
+	touch_xy_t begin;
+	touch_xy_t begin_screen;   // begin through the provisional matrix
+};
+
+constexpr size_t max_contacts = 10;
+
+static void sample_accept(screen_x11_t& scr, touch_point_t& touch_point, size_t idx, touch_xy_t xy,
+	const xorgcal_callbacks_t* callbacks, void* user)
+{
+	touch_point.touch = xy;
+	xy_t pixel = xy_round(xy);
+	draw_touch_point(scr, touch_point.point, WHITE);
+	scr.disc(pixel, 4, BLUE);
+	LOG("sample accepted %zu: %.2f:%.2f", idx, xy.x, xy.y);
+	if (callbacks && callbacks->sample_accepted)
+		callbacks->sample_accepted(idx, pixel.x, pixel.y, user);
+}
+
+bool get_touch_points_parallel(screen_x11_t& scr, touch_point_t* touch_point_list, size_t first, size_t count,
+	const transform_matrix_t& provisional, size_t timeout_s, const xorgcal_callbacks_t* callbacks, void* user)
+{
+	std::array<xy_t, max_touch_points> target{};
+	std::array<bool, max_touch_points> taken{};   // accepted or held
+	count = std::min(count, target.size());
+	first = std::min(first, count);
+	for (size_t idx = 0; idx < count; ++idx)
+		target[idx] = touch_point_list[idx].point;
+	std::fill(taken.begin(), taken.begin() + first, true);
+	for (size_t idx = first; idx < count; ++idx)
+	{
+		draw_touch_point(scr, target[idx], RED);
+		LOG("target shown %zu: %d:%d", idx, target[idx].x, target[idx].y);
+		if (callbacks && callbacks->target_shown)
+			callbacks->target_shown(idx, target[idx].x, target[idx].y, user);
+	}
+	// touch between targets matches none of them
+	double radius = target_match_radius(target.data(), count);
+	std::array<contact_track_t, max_contacts> contact_list{};
+	size_t contact_count = 0;
+	size_t left = count - first;
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_s);
+	while (left > 0)
+	{
+		contact_t contact{};
+		unsigned int keycode = 0;
+		size_t left_before = left;
+		while (left > 0 && scr.get_contact_event(contact, keycode))
+		{
+			auto track = std::find_if(contact_list.begin(), contact_list.begin() + contact_count,
+				[&contact](const contact_track_t& track){ return track.touch_id == contact.touch_id; });
+			bool tracked = track != contact_list.begin() + contact_count;
+			touch_xy_t screen = target_predict(provisional, contact.xy, scr.width_, scr.height_);
+			if (contact.phase == CONTACT_BEGIN)
+			{
+				if (tracked)
+					continue;
+				size_t idx = target_nearest(target.data(), taken.data(), count, screen, radius);
+				LOG("touch %d begin %.2f:%.2f screen %.2f:%.2f target: %d", contact.touch_id,
+					contact.xy.x, contact.xy.y, screen.x, screen.y, idx < count ? static_cast<int>(idx) : -1);
+				if (idx == count)
+					continue;
+				if (contact.touch_id < 0)
+				{
+					taken[idx] = true;
+					--left;
+					sample_accept(scr, touch_point_list[idx], idx, contact.xy, callbacks, user);
+					continue;
+				}
+				if (contact_count == contact_list.size())
+					continue;
+				contact_list[contact_count++] = contact_track_t{contact.touch_id, idx, contact.xy, screen};
+				taken[idx] = true;
+				draw_touch_point(scr, target[idx], BLUE);
+				scr.press_start(target[idx], cross_size);
+				continue;
+			}
+			if (!tracked)
+				continue;
+			touch_xy_t begin = track->begin;
+			size_t idx = track->target;
+			bool slipped = std::hypot(screen.x - track->begin_screen.x, screen.y - track->begin_screen.y) > radius;
+			if (contact.phase == CONTACT_UPDATE && !slipped)
+				continue;
+			*track = contact_list[--contact_count];
+			scr.press_stop(target[idx]);
+			if (contact.phase == CONTACT_END)
+			{
+				--left;
+				sample_accept(scr, touch_point_list[idx], idx, begin, callbacks, user);
+				continue;
+			}
+			// dragged away: target is free again
+			LOG("touch %d slipped off target %zu", contact.touch_id, idx);
+			taken[idx] = false;
+			draw_touch_point(scr, target[idx], RED);
+		}
+		if (left == 0)
+			break;
+		if (keycode != 0)
+			return false;
+		// timeout is per touch as with targets one by one
+		if (left < left_before)
+			deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_s);
+		int left_ms = -1;
+		if (timeout_s != 0)
+		{
+			left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now()).count();
+			if (left_ms <= 0)
+			{
+				ERR("timeout %zu sec. is over", timeout_s);
+				return false;
+			}
+		}
+		scr.wait(-1, left_ms);
+	}
+	return true;
+}
+
+touch_point_list_t touch_point_list_default(int width, int height)
+{
+	touch_point_list_t touch_point_list{};
+
+	int cross_offset_x = width / 9;
+	int cross_offset_y = height / 9;
+	touch_point_list[UL].point = {cross_offset_x, cross_offset_y};
+	touch_point_list[UR].point = {width - cross_offset_x, cross_offset_y};
+	touch_point_list[LL].point = {cross_offset_x, height - cross_offset_y};
+	touch_point_list[LR].point = {width - cross_offset_x, height - cross_offset_y};
+	return touch_point_list;
+}
+
+bool xorg_option_str(const transform_matrix_t& transform_matrix, text_buf_t& out)
+{
+	out.printf("	Option	\"TransformationMatrix\"	\"%f %f %f %f %f %f %f %f %f\"\n",
+		transform_matrix[0], transform_matrix[1], transform_matrix[2],
+		transform_matrix[3], transform_matrix[4], transform_matrix[5],
+		transform_matrix[6], transform_matrix[7], transform_matrix[8]
+		);
+	return !out.overflow();
+}
+
+bool xorg_str(const transform_matrix_t& transform_matrix, const char* device_name, text_buf_t& out)
+{
+	out.append("Section \"InputClass\"\n");
+	// identifier per device, config of several devices can live in one file
+	out.printf("	Identifier	\"calibration %s\"\n", device_name);
+	out.printf("	MatchProduct	\"%s\"\n", device_name);
+	xorg_option_str(transform_matrix, out);
+	out.append("EndSection\n");
+	return !out.overflow();
+}
+
+bool xinput_str(const transform_matrix_t& transform_matrix, const char* device_name, text_buf_t& out)
+{
+	out.printf("xinput set-prop \"%s\" \"Coordinate Transformation Matrix\" %f %f %f %f %f %f %f %f %f \n",
+		device_name,
+		transform_matrix[0], transform_matrix[1], transform_matrix[2],
+		transform_matrix[3], transform_matrix[4], transform_matrix[5],
+		transform_matrix[6], transform_matrix[7], transform_matrix[8]
+		);
+	return !out.overflow();
+}
+
+device_info_t select_device(const device_info_list_t& dev_info_list,
+	const std::string& device_name, int device_id)
+{
+	device_info_t device_info{.calibratable = false};
+	bool multiple = false;
+	for (auto info : dev_info_list)
+	{
+		if (device_id == info.xid)
+			return info;
+		if (device_name == info.name)
+			return info;
+		if (info.calibratable)
+		{
+			if (device_info.calibratable)
+				multiple = true;
+			device_info = info;
+		}
+	}
+	if (multiple)
+		ERR("Warning: multiple calibratable devices found, calibrating last one (%s)\n\t"
+			"use --device to select another one.\n", device_info.name.c_str());
+	if (!device_info.calibratable && !device_name.empty())
+		ERR("Error: Device \"%s\" not found; use --list to list the calibratable input devices.\n", device_name.c_str());
+	if (!device_info.calibratable && device_id != -1)
+		ERR("Error: Device id: %d not found; use --list to list the calibratable input devices.\n", device_id);
+	return device_info;
+}
+
+bool reset_calibration(Display *display, int deviceid)
+{
+	return set_matrix(display, deviceid, transform_matrix_identity());
+}
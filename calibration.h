@@ -0,0 +1,51 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "common.h"
+#include "evdev_device.h"
+#include "screen_x11.h"
+#include "text_buf.h"
+#include "touch_device.h"
+#include "transform_matrix.h"
+#include "xorgcal.h"
+
+#include <X11/Xlib.h>
+
+#include <string>
+#include <vector>
+
+constexpr int cross_size = 100;
+
+void draw_touch_point(screen_x11_t& scr, xy_t xy, color_index_t color_index);
+void draw_message(screen_x11_t& scr, const std::vector<std::string>& str_list);
+// evdev nullptr - touches from X button events
+bool wait_touch_or_key(screen_x11_t& scr, evdev_device_t* evdev, touch_xy_t& xy, size_t timeout_s);
+// Shows target idx at touch_point.point and fills touch_point.touch, previous target is dimmed.
+// callbacks and prev can be nullptr
+bool get_touch_point(screen_x11_t& scr, evdev_device_t* evdev, size_t idx, touch_point_t& touch_point,
+	const touch_point_t* prev, size_t timeout_s, const xorgcal_callbacks_t* callbacks, void* user);
+// callbacks can be nullptr
+bool get_touch_point_list(screen_x11_t& scr, evdev_device_t* evdev, touch_point_list_t& touch_point_list,
+	size_t timeout_s, const xorgcal_callbacks_t* callbacks, void* user);
+// Targets first..count-1 at once, touch_point_list[idx].point, concurrent touches
+// are told apart by XI2 touch id (see screen_x11_t::touch_select()). Each touch is
+// mapped through provisional (fit of the targets before first, so mirrored or
+// swapped panels match too), matched to the nearest free target and accepted
+// when lifted, button press right away.
+// callbacks can be nullptr
+bool get_touch_points_parallel(screen_x11_t& scr, touch_point_t* touch_point_list, size_t first, size_t count,
+	const transform_matrix_t& provisional, size_t timeout_s, const xorgcal_callbacks_t* callbacks, void* user);
+// Targets at 1/9 of the screen size from the corners.
+touch_point_list_t touch_point_list_default(int width, int height);
+
+device_info_t select_device(const device_info_list_t& dev_info_list,
+	const std::string& device_name, int device_id);
+bool reset_calibration(Display *display, int deviceid);
+
+// Append to out, false if it does not fit.
+// Option "TransformationMatrix" line of InputClass section.
+bool xorg_option_str(const transform_matrix_t& transform_matrix, text_buf_t& out);
+bool xorg_str(const transform_matrix_t& transform_matrix, const char* device_name, text_buf_t& out);
+bool xinput_str(const transform_matrix_t& transform_matrix, const char* device_name, text_buf_t& out);
+
+#endif  // CALIBRATION_H
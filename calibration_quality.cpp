@@ -0,0 +1,155 @@
+#include "calibration_quality.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static double residual_px(const mat33<double>& matr, const touch_point_t& touch_point, int width, int height)
+{
+	vec2<double> xy = apply(matr, vec2<double>{{
+		1. * touch_point.touch.x / width,
+		1. * touch_point.touch.y / height}});
+	double dx = xy[0] * width - touch_point.point.x;
+	double dy = xy[1] * height - touch_point.point.y;
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+// X^T X, X rows are normalized (tx, ty, 1).
+static mat33<double> design_matrix(const touch_point_t* touch_point_list, size_t count, int width, int height)
+{
+	mat33<double> xtx = mat33<double>::zero();
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		vec3<double> t{{
+			1. * touch_point_list[idx].touch.x / width,
+			1. * touch_point_list[idx].touch.y / height,
+			1.}};
+		for (size_t row = 0; row < 3; ++row)
+			for (size_t col = 0; col < 3; ++col)
+				xtx.m[row][col] += t[row] * t[col];
+	}
+	return xtx;
+}
+
+// sqrt of eigenvalue ratio of X^T X.
+static double condition_number(const touch_point_t* touch_point_list, size_t count, int width, int height)
+{
+	vec3<double> eigen = symmetric_eigenvalues(design_matrix(touch_point_list, count, width, height));
+	if (eigen[0] <= 0)
+		return INFINITY;
+	return std::sqrt(eigen[2] / eigen[0]);
+}
+
+double leverage(const touch_point_t* touch_point_list, size_t count, touch_xy_t touch, int width, int height)
+{
+	mat33<double> xtx_inv{};
+	if (!inverse(design_matrix(touch_point_list, count, width, height), xtx_inv))
+		return INFINITY;
+	vec3<double> t{{1. * touch.x / width, 1. * touch.y / height, 1.}};
+	return dot(t, xtx_inv * t);
+}
+
+calibration_quality_t calibration_quality(const touch_point_t* touch_point_list, size_t count,
+	const transform_matrix_t& matr, int width, int height)
+{
+	calibration_quality_t quality{};
+	count = std::min(count, quality.target.size());
+	quality.count = count;
+	mat33<double> matr_d = to_mat<double>(matr);
+
+	// leave-one-out: affine fit on the rest of the targets predicts the left out one
+	std::array<touch_point_t, max_touch_points> rest{};
+	double sum_sq = 0;
+	double loo_sum_sq = 0;
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		target_quality_t& target = quality.target[idx];
+		target.point = touch_point_list[idx].point;
+		target.touch = touch_point_list[idx].touch;
+		target.residual_px = residual_px(matr_d, touch_point_list[idx], width, height);
+		sum_sq += target.residual_px * target.residual_px;
+		quality.max_px = std::max(quality.max_px, target.residual_px);
+
+		std::copy(touch_point_list, touch_point_list + idx, rest.begin());
+		std::copy(touch_point_list + idx + 1, touch_point_list + count, rest.begin() + idx);
+		transform_matrix_t loo = transform_matrix_lsq(rest.data(), count - 1, width, height);
+		target.loo_px = transform_matrix_valid(loo) ?
+			residual_px(to_mat<double>(loo), touch_point_list[idx], width, height) : INFINITY;
+		loo_sum_sq += target.loo_px * target.loo_px;
+		quality.loo_max_px = std::max(quality.loo_max_px, target.loo_px);
+	}
+	if (count > 0)
+	{
+		quality.rms_px = std::sqrt(sum_sq / count);
+		quality.loo_rms_px = std::sqrt(loo_sum_sq / count);
+	}
+	quality.condition = condition_number(touch_point_list, count, width, height);
+	return quality;
+}
+
+// JSON has no infinity, null is used instead.
+// Huge values of near singular fits are in exponent form to keep the size bounded.
+static void json_number(text_buf_t& out, const char* key, double val)
+{
+	if (std::isfinite(val) && std::fabs(val) < 1e9)
+		out.printf("\"%s\":%.3f", key, val);
+	else if (std::isfinite(val))
+		out.printf("\"%s\":%.6g", key, val);
+	else
+		out.printf("\"%s\":null", key);
+}
+
+bool calibration_quality_json(const calibration_quality_t& quality, text_buf_t& out)
+{
+	out.append("{\"targets\":[");
+	for (size_t idx = 0; idx < quality.count; ++idx)
+	{
+		const target_quality_t& target = quality.target[idx];
+		out.printf("%s{\"point\":[%d,%d],\"touch\":[%.2f,%.2f],",
+			idx > 0 ? "," : "",
+			target.point.x, target.point.y, target.touch.x, target.touch.y);
+		json_number(out, "residual_px", target.residual_px);
+		out.append(",");
+		json_number(out, "loo_px", target.loo_px);
+		out.append("}");
+	}
+	out.append("],");
+	json_number(out, "rms_px", quality.rms_px);
+	out.append(",");
+	json_number(out, "max_px", quality.max_px);
+	out.append(",");
+	json_number(out, "loo_rms_px", quality.loo_rms_px);
+	out.append(",");
+	json_number(out, "loo_max_px", quality.loo_max_px);
+	out.append(",");
+	json_number(out, "condition", quality.condition);
+	out.append("}");
+	return !out.overflow();
+}
+
+bool seat_report_json(const char* display_name, const char* device_name, bool ok,
+	const transform_matrix_t& matr, const char* attempts, text_buf_t& out)
+{
+	out.append("{\"display\":").append_json_str(display_name);
+	out.append(",\"device\":").append_json_str(device_name);
+	out.append(ok ? ",\"ok\":true," : ",\"ok\":false,");
+	out.printf("\"matrix\":[%f,%f,%f,%f,%f,%f,%f,%f,%f],",
+		matr[0], matr[1], matr[2], matr[3], matr[4], matr[5], matr[6], matr[7], matr[8]);
+	// JSON lines become array items
+	out.append("\"attempts\":[");
+	const char* separator = "";
+	for (const char* line = attempts; *line != '\0'; )
+	{
+		const char* newline = strchr(line, '\n');
+		size_t len = newline != nullptr ? newline - line : strlen(line);
+		if (len > 0)
+		{
+			out.append(separator).append(line, len);
+			separator = ",";
+		}
+		line += newline != nullptr ? len + 1 : len;
+	}
+	out.append("]}");
+	return !out.overflow();
+}
@@ -0,0 +1,47 @@
+#ifndef CALIBRATION_QUALITY_H
+#define CALIBRATION_QUALITY_H
+
+#include "common.h"
+#include "text_buf.h"
+#include "transform_matrix.h"
+
+#include <array>
+
+struct target_quality_t
+{
+	xy_t point;
+	touch_xy_t touch;
+	double residual_px;  // matrix applied to the touch vs target
+	double loo_px;       // prediction error of the matrix fitted without this target
+};
+
+struct calibration_quality_t
+{
+	std::array<target_quality_t, max_touch_points> target;
+	size_t count;
+	double rms_px;
+	double max_px;
+	double loo_rms_px;
+	double loo_max_px;
+	double condition;    // condition number of the touch design matrix
+};
+
+// Scores the matrix computed from the touch points, touch and point coordinates in pixels.
+calibration_quality_t calibration_quality(const touch_point_t* touch_point_list, size_t count,
+	const transform_matrix_t& matr, int width, int height);
+// Prediction variance of the affine fit at touch position relative to
+// touch noise variance (x^T (X^T X)^-1 x), infinity if points are degenerate.
+double leverage(const touch_point_t* touch_point_list, size_t count, touch_xy_t touch, int width, int height);
+
+// Appends JSON report, false if it does not fit.
+bool calibration_quality_json(const calibration_quality_t& quality, text_buf_t& out);
+
+// Fits the report of max_touch_points targets.
+using quality_json_storage_t = std::array<char, 256 + max_touch_points * 128>;
+
+// Appends one seat of the multiseat report, attempts - JSON lines of
+// calibration_quality_json() reports, false if it does not fit.
+bool seat_report_json(const char* display_name, const char* device_name, bool ok,
+	const transform_matrix_t& matr, const char* attempts, text_buf_t& out);
+
+#endif  // CALIBRATION_QUALITY_H
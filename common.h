@@ -3,6 +3,8 @@
 
 #define HAVE_XFT 1
 
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <array>
 #include <vector>
@@ -31,12 +33,28 @@ enum {
     NUM_POINTS
 };
 
+// Touch position in screen pixels, fractional where the source has it
+// (evdev axis mapping, XI2 event_x/event_y), whole pixels of core button events.
+struct touch_xy_t
+{
+	double x;
+	double y;
+};
+
+inline xy_t xy_round(const touch_xy_t& xy)
+{
+	return xy_t{static_cast<coordinate_t>(std::lround(xy.x)), static_cast<coordinate_t>(std::lround(xy.y))};
+}
+
 struct touch_point_t
 {
 	xy_t point;
-	xy_t touch;
+	touch_xy_t touch;
 };
 
 using touch_point_list_t = std::array<touch_point_t, 4>;
 
+// Capacity of fixed size point storage for sessions with more targets.
+constexpr size_t max_touch_points = 25;
+
 #endif  // COMMON_H
@@ -0,0 +1,489 @@
+#include "control_server.h"
+#include "calibration.h"
+#include "text_buf.h"
+#include "touch_device.h"
+#include "unix_socket.h"
+#include "log.h"
+
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <string>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool write_all(int fd, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		// client gone shall not kill the server with SIGPIPE
+		ssize_t len = send(fd, data, size, MSG_NOSIGNAL);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			return false;
+		data += len;
+		size -= len;
+	}
+	return true;
+}
+
+// Waits up to timeout_ms (-1 - forever) for fd to be readable, false on timeout (errno EAGAIN).
+static bool read_wait(int fd, int timeout_ms)
+{
+	pollfd poll_fd{fd, POLLIN, 0};
+	for (;;)
+	{
+		int rc = poll(&poll_fd, 1, timeout_ms);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc == 0)
+			errno = EAGAIN;
+		return rc > 0;
+	}
+}
+
+// Returns 1 on success, 0 on end of stream before the first byte, -1 on error.
+// Once the message has begun (started or a byte read) every read waits up to timeout_ms.
+static int read_all(int fd, char* data, size_t size, bool started, int timeout_ms)
+{
+	size_t done = 0;
+	while (done < size)
+	{
+		if ((started || done > 0) && !read_wait(fd, timeout_ms))
+			return -1;
+		ssize_t len = read(fd, data + done, size - done);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0)
+			return -1;
+		if (len == 0)
+			return done == 0 ? 0 : -1;
+		done += len;
+	}
+	return 1;
+}
+
+bool control_message_write(int fd, const std::string& payload)
+{
+	if (payload.size() > control_message_max)
+		return false;
+	uint32_t len = htonl(static_cast<uint32_t>(payload.size()));
+	return write_all(fd, reinterpret_cast<const char*>(&len), sizeof(len)) &&
+		write_all(fd, payload.data(), payload.size());
+}
+
+int control_message_read(int fd, std::string& payload, int timeout_ms)
+{
+	uint32_t len = 0;
+	int rc = read_all(fd, reinterpret_cast<char*>(&len), sizeof(len), false, timeout_ms);
+	if (rc <= 0)
+		return rc;
+	len = ntohl(len);
+	if (len > control_message_max)
+	{
+		ERR("message too long: %u", len);
+		return -1;
+	}
+	payload.resize(len);
+	if (len > 0 && read_all(fd, &payload[0], len, true, timeout_ms) != 1)
+		return -1;
+	return 1;
+}
+
+static bool matrix_parse(const std::string& str, transform_matrix_t& matr)
+{
+	std::istringstream stream(str);
+	for (size_t idx = 0; idx < matr.size(); ++idx)
+	{
+		if (idx > 0 && stream.get() != ',')
+			return false;
+		if (!(stream >> matr[idx]))
+			return false;
+	}
+	return stream.peek() == std::char_traits<char>::eof();
+}
+
+bool control_request_parse(const std::string& text, const xorgcal_options_t& defaults,
+	control_request_t& request, std::string& error)
+{
+	request = control_request_t{};
+	request.options = defaults;
+	std::istringstream stream(text);
+	if (!(stream >> request.command))
+	{
+		error = "empty request";
+		return false;
+	}
+	if (request.command != "list" && request.command != "reset" &&
+		request.command != "apply" && request.command != "calibrate")
+	{
+		error = "unknown command: " + request.command;
+		return false;
+	}
+	std::string arg;
+	while (stream >> arg)
+	{
+		size_t pos = arg.find('=');
+		std::string key = arg.substr(0, pos);
+		std::string val = pos == std::string::npos ? std::string{} : arg.substr(pos + 1);
+		if (key == "device_id")
+			request.device_id = strtol(val.c_str(), NULL, 10);
+		else if (key == "device_name")
+			request.device_name = val;
+		else if (key == "refresh")
+			request.refresh = true;
+		else if (key == "matrix")
+		{
+			if (!matrix_parse(val, request.matrix))
+			{
+				error = "matrix shall be 9 comma separated numbers: " + val;
+				return false;
+			}
+			request.has_matrix = true;
+		}
+		else if (key == "timeout")
+			request.options.timeout = strtol(val.c_str(), NULL, 10);
+		else if (key == "max_error")
+			request.options.max_error_px = strtod(val.c_str(), NULL);
+		else if (key == "retries")
+			request.options.retries = strtol(val.c_str(), NULL, 10);
+		else if (key == "adaptive")
+			request.options.adaptive = 1;
+		else if (key == "tolerance")
+			request.options.tolerance_px = strtod(val.c_str(), NULL);
+		else if (key == "max_targets")
+			request.options.max_targets = strtol(val.c_str(), NULL, 10);
+		else if (key == "grid")
+			request.options.grid = strtol(val.c_str(), NULL, 10);
+		else if (key == "multitouch")
+			request.options.multitouch = 1;
+		else if (key == "backend")
+			request.backend = val;
+		else if (key == "evdev_node")
+			request.evdev_node = val;
+		else
+		{
+			error = "unknown argument: " + key;
+			return false;
+		}
+	}
+	if (request.command == "apply" && !request.has_matrix)
+	{
+		error = "apply needs matrix=";
+		return false;
+	}
+	if (request.backend != "x11" && request.backend != "evdev")
+	{
+		error = "unknown backend: " + request.backend;
+		return false;
+	}
+	return true;
+}
+
+static std::string json_str(const std::string& str)
+{
+	std::string out;
+	json_escape(str.c_str(), [&out](const char* data, size_t len){ out.append(data, len); });
+	return out;
+}
+
+static std::string json_matrix(const float matrix[9])
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "[%f,%f,%f,%f,%f,%f,%f,%f,%f]",
+		matrix[0], matrix[1], matrix[2],
+		matrix[3], matrix[4], matrix[5],
+		matrix[6], matrix[7], matrix[8]);
+	return buf;
+}
+
+static const char* status_str(int status)
+{
+	switch (status)
+	{
+	case XORGCAL_OK: return "ok";
+	case XORGCAL_NO_DEVICE: return "no_device";
+	case XORGCAL_ABORTED: return "aborted";
+	case XORGCAL_INVALID_MATRIX: return "invalid_matrix";
+	case XORGCAL_INACCURATE: return "inaccurate";
+	default: return "error";
+	}
+}
+
+struct control_client_t
+{
+	int fd;
+	bool ok;   // false after write error, rest of the request is not sent
+};
+
+static void client_send(control_client_t& client, const std::string& json)
+{
+	if (!client.ok)
+		return;
+	LOG("send: %s", json.c_str());
+	if (!control_message_write(client.fd, json))
+	{
+		ERR("failed: control_message_write(): %s", strerror(errno));
+		client.ok = false;
+	}
+}
+
+static void error_send(control_client_t& client, const std::string& message)
+{
+	client_send(client, "{\"event\":\"error\",\"message\":" + json_str(message) + "}");
+}
+
+static void result_send(control_client_t& client, const control_request_t& request, int status,
+	const device_info_t* device, const float* matrix)
+{
+	std::string json = "{\"event\":\"result\",\"command\":" + json_str(request.command) +
+		",\"status\":\"" + status_str(status) + "\"";
+	if (device != nullptr)
+		json += ",\"device_id\":" + std::to_string(device->xid) + ",\"device\":" + json_str(device->name);
+	if (matrix != nullptr)
+		json += ",\"matrix\":" + json_matrix(matrix);
+	client_send(client, json + "}");
+}
+
+static void target_shown(int index, int x, int y, void* user)
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "{\"event\":\"target_shown\",\"index\":%d,\"x\":%d,\"y\":%d}", index, x, y);
+	client_send(*static_cast<control_client_t*>(user), buf);
+}
+
+static void sample_accepted(int index, int x, int y, void* user)
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "{\"event\":\"sample_accepted\",\"index\":%d,\"x\":%d,\"y\":%d}", index, x, y);
+	client_send(*static_cast<control_client_t*>(user), buf);
+}
+
+static void matrix_computed(const float matrix[9], void* user)
+{
+	client_send(*static_cast<control_client_t*>(user),
+		"{\"event\":\"matrix_computed\",\"matrix\":" + json_matrix(matrix) + "}");
+}
+
+static void quality_report(const char* json, void* user)
+{
+	client_send(*static_cast<control_client_t*>(user),
+		std::string("{\"event\":\"quality\",\"report\":") + json + "}");
+}
+
+// Device list is read once and kept, XI queries are repeated only on
+// "list refresh" or when the requested device is not in the list.
+struct device_cache_t
+{
+	device_info_list_t list;
+	bool valid = false;
+};
+
+static const device_info_list_t& device_cache_get(Display* display, device_cache_t& cache, bool refresh)
+{
+	if (!cache.valid || refresh)
+	{
+		cache.list = device_info_list_get(display);
+		cache.valid = true;
+		LOG("device cache: %zu devices", cache.list.size());
+	}
+	return cache.list;
+}
+
+static bool device_find(Display* display, device_cache_t& cache, const control_request_t& request,
+	device_info_t& device)
+{
+	bool specific = request.device_id != -1 || !request.device_name.empty();
+	for (bool refresh : {false, true})
+	{
+		device = select_device(device_cache_get(display, cache, refresh), request.device_name, request.device_id);
+		bool match = !specific ||
+			(request.device_id != -1 && device.xid == static_cast<XID>(request.device_id)) ||
+			(!request.device_name.empty() && device.name == request.device_name);
+		if (match && device.calibratable)
+			return true;
+	}
+	return false;
+}
+
+static void list_request(Display* display, device_cache_t& cache, const control_request_t& request,
+	control_client_t& client)
+{
+	bool cached = cache.valid && !request.refresh;
+	std::string json = std::string("{\"event\":\"devices\",\"cached\":") + (cached ? "true" : "false") + ",\"devices\":[";
+	const device_info_list_t& list = device_cache_get(display, cache, request.refresh);
+	for (const auto& info : list)
+		json += (&info == &list.front() ? "{\"id\":" : ",{\"id\":") + std::to_string(info.xid) +
+			",\"name\":" + json_str(info.name) +
+			",\"calibratable\":" + (info.calibratable ? "true}" : "false}");
+	client_send(client, json + "]}");
+}
+
+static void calibrate_request(Display* display, const device_info_t& device, const control_request_t& request,
+	control_client_t& client)
+{
+	// failed calibration leaves the device as it was, not with identity matrix
+	transform_matrix_t previous{};
+	bool has_previous = get_matrix(display, device.xid, previous);
+	if (!reset_calibration(display, device.xid))
+	{
+		result_send(client, request, XORGCAL_ERROR, &device, nullptr);
+		return;
+	}
+	xorgcal_session_t* session = xorgcal_session_new(display, &request.options);
+	if (session == nullptr)
+	{
+		result_send(client, request, XORGCAL_ERROR, &device, nullptr);
+		return;
+	}
+	int rc = XORGCAL_OK;
+	if (request.backend == "evdev")
+		rc = xorgcal_session_evdev(session, device.xid,
+			request.evdev_node.empty() ? nullptr : request.evdev_node.c_str());
+	xorgcal_callbacks_t callbacks;
+	xorgcal_callbacks_init(&callbacks);
+	callbacks.target_shown = target_shown;
+	callbacks.sample_accepted = sample_accepted;
+	callbacks.matrix_computed = matrix_computed;
+	callbacks.quality_report = quality_report;
+	std::array<float, 9> matrix{};
+	if (rc == XORGCAL_OK)
+		rc = xorgcal_session_run(session, &callbacks, &client, matrix.data());
+	xorgcal_session_free(session);
+
+	if (rc == XORGCAL_OK)
+	{
+		transform_matrix_t matr{};
+		std::copy(matrix.begin(), matrix.end(), matr.begin());
+		if (!set_matrix(display, device.xid, matr))
+			rc = XORGCAL_ERROR;
+	}
+	else if (has_previous)
+		set_matrix(display, device.xid, previous);
+	result_send(client, request, rc, &device, rc == XORGCAL_OK ? matrix.data() : nullptr);
+}
+
+static void request_handle(Display* display, device_cache_t& cache, const xorgcal_options_t& defaults,
+	const std::string& text, control_client_t& client)
+{
+	LOG("request: %s", text.c_str());
+	control_request_t request;
+	std::string error;
+	if (!control_request_parse(text, defaults, request, error))
+	{
+		error_send(client, error);
+		return;
+	}
+	if (request.command == "list")
+	{
+		list_request(display, cache, request, client);
+		return;
+	}
+
+	device_info_t device{};
+	if (!device_find(display, cache, request, device))
+	{
+		result_send(client, request, XORGCAL_NO_DEVICE, nullptr, nullptr);
+		return;
+	}
+	if (request.command == "reset")
+		result_send(client, request, reset_calibration(display, device.xid) ? XORGCAL_OK : XORGCAL_ERROR,
+			&device, nullptr);
+	else if (request.command == "apply")
+	{
+		int rc = transform_matrix_valid(request.matrix) && set_matrix(display, device.xid, request.matrix) ?
+			XORGCAL_OK : XORGCAL_ERROR;
+		result_send(client, request, rc, &device, request.matrix.data());
+	}
+	else if (request.command == "calibrate")
+		calibrate_request(display, device, request, client);
+}
+
+// Owner only: the server sets device matrices and grabs the screen.
+static int socket_listen(const char* socket_path)
+{
+	int fd = unix_socket_bind(socket_path, SOCK_STREAM | SOCK_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	if (chmod(socket_path, S_IRUSR | S_IWUSR) != 0 || listen(fd, 4) != 0)
+	{
+		ERR("failed: listen(): %s : %s", socket_path, strerror(errno));
+		close(fd);
+		unix_socket_unlink(socket_path);
+		return -1;
+	}
+	return fd;
+}
+
+// The socket mode is set after bind: a client of another user may have connected
+// in between, credentials are checked. Root is always allowed.
+static bool client_allowed(int fd)
+{
+	ucred cred{};
+	socklen_t len = sizeof(cred);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+	{
+		ERR("failed: getsockopt(SO_PEERCRED): %s", strerror(errno));
+		return false;
+	}
+	return unix_socket_peer_allowed(cred);
+}
+
+// Clients are served one at a time: a client stalled mid message or not reading
+// its events shall not hold the server. Reads time out in control_message_read()
+// only within a message: waiting for the next request or for a long calibrate
+// to finish is fine.
+static void client_timeout_set(int fd)
+{
+	timeval timeout{control_client_timeout_s, 0};
+	if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0)
+		ERR("failed: setsockopt(SO_SNDTIMEO): %s", strerror(errno));
+}
+
+bool control_server_run(Display* display, const char* socket_path, const xorgcal_options_t& defaults)
+{
+	int fd = socket_listen(socket_path);
+	if (fd < 0)
+		return false;
+	device_cache_t cache;
+	device_cache_get(display, cache, false);
+	LOG("listening: %s", socket_path);
+
+	for (;;)
+	{
+		int client_fd = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client_fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			ERR("failed: accept(): %s", strerror(errno));
+			break;
+		}
+		if (!client_allowed(client_fd))
+		{
+			close(client_fd);
+			continue;
+		}
+		client_timeout_set(client_fd);
+		control_client_t client{client_fd, true};
+		std::string text;
+		int rc = 0;
+		while (client.ok && (rc = control_message_read(client_fd, text, control_client_timeout_s * 1000)) > 0)
+			request_handle(display, cache, defaults, text, client);
+		if (rc < 0)
+			ERR("client dropped: %s", errno == EAGAIN ? "timeout" : "read error");
+		close(client_fd);
+	}
+	close(fd);
+	unix_socket_unlink(socket_path);
+	return false;
+}
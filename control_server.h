@@ -0,0 +1,56 @@
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+// Control API on a unix stream socket for process managers (kiosk etc.).
+// Messages in both directions are 4 byte big endian payload length followed by payload.
+// Requests are a command with key=val arguments, like the command line:
+//   list [refresh]
+//   reset [device_id=N] [device_name=S]
+//   apply [device_id=N] [device_name=S] matrix=m0,m1,...,m8
+//   calibrate [device_id=N] [device_name=S] [timeout=S] [max_error=PX] [retries=N]
+//             [adaptive] [tolerance=PX] [max_targets=N] [grid=N] [multitouch]
+//             [backend=x11|evdev] [evdev_node=PATH]
+// Responses are JSON objects, one per message: progress events of calibration
+// ("target_shown", "sample_accepted", "quality", "matrix_computed") and
+// "devices" / "result" / "error" closing the request.
+// One X connection and the device list are kept across requests.
+
+#include "transform_matrix.h"
+#include "xorgcal.h"
+
+#include <X11/Xlib.h>
+
+#include <string>
+
+constexpr size_t control_message_max = 64 * 1024;
+// Client stalled within a request or not reading events is disconnected after it.
+constexpr int control_client_timeout_s = 30;
+
+bool control_message_write(int fd, const std::string& payload);
+// Returns 1 on message, 0 on end of stream, -1 on error or oversized message.
+// The first byte is waited for forever, the rest of a begun message up to
+// timeout_ms (-1 - forever) per read, -1 with errno EAGAIN on timeout.
+int control_message_read(int fd, std::string& payload, int timeout_ms = -1);
+
+struct control_request_t
+{
+	std::string command;
+	std::string device_name;
+	int device_id = -1;
+	bool refresh = false;          // list: re-read devices from the server
+	bool has_matrix = false;
+	transform_matrix_t matrix{};   // apply
+	std::string backend = "x11";   // calibrate
+	std::string evdev_node;
+	xorgcal_options_t options;     // calibrate: server defaults overridden by arguments
+};
+
+// Returns false on unknown command or argument, error is set.
+bool control_request_parse(const std::string& text, const xorgcal_options_t& defaults,
+	control_request_t& request, std::string& error);
+
+// Serves clients one at a time, requests of a client in order. The socket is
+// owner only (0600), clients of other users except root are refused. Returns only on error.
+bool control_server_run(Display* display, const char* socket_path, const xorgcal_options_t& defaults);
+
+#endif  // CONTROL_SERVER_H
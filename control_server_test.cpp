@@ -0,0 +1,107 @@
+#include "control_server.h"
+#include "log.h"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// Framing over a socket pair, no X needed.
+void message_test()
+{
+	int fd[2];
+	ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == 0);
+
+	std::string payload;
+	ASSERT(control_message_write(fd[0], "list"));
+	ASSERT(control_message_write(fd[0], ""));
+	std::string big(control_message_max, 'x');
+	ASSERT(!control_message_write(fd[0], big + "x"));
+	ASSERT(control_message_read(fd[1], payload) == 1 && payload == "list");
+	ASSERT(control_message_read(fd[1], payload) == 1 && payload.empty());
+
+	// length is big endian
+	const char header[] = {0, 0, 0, 3, 'a', 'b', 'c'};
+	ASSERT(write(fd[0], header, sizeof(header)) == sizeof(header));
+	ASSERT(control_message_read(fd[1], payload) == 1 && payload == "abc");
+
+	// oversized length is rejected before reading the payload
+	uint32_t len = htonl(control_message_max + 1);
+	ASSERT(write(fd[0], &len, sizeof(len)) == sizeof(len));
+	ASSERT(control_message_read(fd[1], payload) == -1);
+	close(fd[0]);
+	close(fd[1]);
+
+	// clean end of stream vs stream cut inside a message
+	ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == 0);
+	ASSERT(write(fd[0], header, 5) == 5);
+	close(fd[0]);
+	ASSERT(control_message_read(fd[1], payload) == -1);
+	close(fd[1]);
+	ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == 0);
+	close(fd[0]);
+	ASSERT(control_message_read(fd[1], payload) == 0);
+	close(fd[1]);
+
+	// timeout applies within a message only: a request arriving late is read,
+	// one stalled after its header is dropped
+	ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == 0);
+	std::thread late([&fd, &header]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		ASSERT(write(fd[0], header, sizeof(header)) == sizeof(header));
+	});
+	ASSERT(control_message_read(fd[1], payload, 50) == 1 && payload == "abc");
+	late.join();
+	ASSERT(write(fd[0], header, 5) == 5);
+	ASSERT(control_message_read(fd[1], payload, 50) == -1 && errno == EAGAIN);
+	close(fd[0]);
+	close(fd[1]);
+}
+
+void request_test()
+{
+	xorgcal_options_t defaults;
+	xorgcal_options_init(&defaults);
+	defaults.timeout = 30;
+	control_request_t request;
+	std::string error;
+
+	ASSERT(control_request_parse("list refresh", defaults, request, error));
+	ASSERT(request.command == "list" && request.refresh);
+
+	ASSERT(control_request_parse("calibrate device_id=11 adaptive max_targets=9 backend=evdev", defaults, request, error));
+	ASSERT(request.command == "calibrate" && request.device_id == 11);
+	ASSERT(request.options.adaptive == 1 && request.options.max_targets == 9);
+	ASSERT(request.options.timeout == 30 && request.options.retries == defaults.retries);
+	ASSERT(request.backend == "evdev");
+	ASSERT(request.options.grid == 2 && request.options.multitouch == 0);
+
+	ASSERT(control_request_parse("calibrate grid=3 multitouch", defaults, request, error));
+	ASSERT(request.options.grid == 3 && request.options.multitouch == 1);
+
+	ASSERT(control_request_parse("apply device_name=touch matrix=1,0,0.5,0,1,-0.25,0,0,1", defaults, request, error));
+	ASSERT(request.has_matrix && request.device_name == "touch");
+	ASSERT(request.matrix[2] == 0.5f && request.matrix[5] == -0.25f && request.matrix[8] == 1.f);
+
+	ASSERT(!control_request_parse("apply matrix=1,0,0,0,1,0,0,0", defaults, request, error));
+	ASSERT(!control_request_parse("apply matrix=1,0,0,0,1,0,0,0,1,2", defaults, request, error));
+	ASSERT(!control_request_parse("apply device_id=3", defaults, request, error));
+	ASSERT(!control_request_parse("calibrate backend=mouse", defaults, request, error));
+	ASSERT(!control_request_parse("calibrate colour=red", defaults, request, error));
+	ASSERT(!control_request_parse("shutdown", defaults, request, error));
+	ASSERT(error == "unknown command: shutdown");
+	ASSERT(!control_request_parse("", defaults, request, error));
+}
+
+int main()
+{
+	message_test();
+	request_test();
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,208 @@
+#include "drift_monitor.h"
+#include "touch_device.h"
+#include "unix_socket.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static mat<3, 2, double> theta_from_matrix(const transform_matrix_t& matr)
+{
+	mat<3, 2, double> theta{};
+	for (size_t idx = 0; idx < 3; ++idx)
+	{
+		theta.m[idx][0] = matr[idx];
+		theta.m[idx][1] = matr[3 + idx];
+	}
+	return theta;
+}
+
+drift_estimator_t::drift_estimator_t(const transform_matrix_t& current, int width, int height, const drift_config_t& config)
+: config_(config)
+, width_(width)
+, height_(height)
+, current_(current)
+, rls_(theta_from_matrix(current), config.p0, config.lambda, config.p_max)
+, current_inv_()
+, corner_raw_()
+, samples_(0)
+, window_touch_x_()
+, window_touch_y_()
+, window_point_x_()
+, window_point_y_()
+, window_count_(0)
+, window_next_(0)
+{
+	set_current(current);
+}
+
+void drift_estimator_t::set_current(const transform_matrix_t& matr)
+{
+	if (!inverse(to_mat<double>(matr), current_inv_))
+	{
+		ERR("current matrix is singular: %s", transform_matrix_to_str(matr).c_str());
+		current_inv_ = mat33<double>::identity();
+	}
+	current_ = matr;
+	const double corners[4][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+	for (size_t idx = 0; idx < corner_raw_.size(); ++idx)
+		corner_raw_[idx] = current_inv_ * vec3<double>{{corners[idx][0], corners[idx][1], 1}};
+	samples_ = 0;
+}
+
+bool drift_estimator_t::add_sample(xy_t target, xy_t event)
+{
+	vec3<double> screen{{1. * event.x / width_, 1. * event.y / height_, 1}};
+	vec3<double> raw = current_inv_ * screen;
+	raw = raw / raw[2];
+	vec2<double> expected{{1. * target.x / width_, 1. * target.y / height_}};
+
+	vec2<double> predicted = rls_.predict(raw);
+	double dx = (predicted[0] - expected[0]) * width_;
+	double dy = (predicted[1] - expected[1]) * height_;
+	if (std::sqrt(dx * dx + dy * dy) > config_.outlier_px)
+	{
+		LOG("outlier: target %d:%d event %d:%d", target.x, target.y, event.x, event.y);
+		return false;
+	}
+
+	rls_.update(raw, expected);
+	++samples_;
+	window_touch_x_[window_next_] = raw[0];
+	window_touch_y_[window_next_] = raw[1];
+	window_point_x_[window_next_] = expected[0];
+	window_point_y_[window_next_] = expected[1];
+	window_next_ = (window_next_ + 1) % drift_window;
+	window_count_ = std::min(window_count_ + 1, drift_window);
+	if (samples_ < config_.min_samples)
+		return false;
+	double divergence = divergence_px();
+	if (divergence <= config_.threshold_px)
+		return false;
+	transform_matrix_t matr = estimate();
+	if (divergence <= config_.max_step_px && transform_matrix_valid(matr) &&
+		window_residuals(matr).rms <= window_residuals(current_).rms)
+		return true;
+	LOG("estimate rejected: corner moved %f px, matrix: %s", divergence, transform_matrix_to_str(matr).c_str());
+	rls_.theta = theta_from_matrix(current_);
+	samples_ = 0;
+	return false;
+}
+
+transform_matrix_t drift_estimator_t::estimate() const
+{
+	mat33<double> matr = mat33<double>::identity();
+	for (size_t idx = 0; idx < 3; ++idx)
+	{
+		matr.m[0][idx] = rls_.theta.m[idx][0];
+		matr.m[1][idx] = rls_.theta.m[idx][1];
+	}
+	return to_transform_matrix(matr);
+}
+
+residual_stats_t drift_estimator_t::window_residuals(const transform_matrix_t& matr) const
+{
+	// order does not matter for the stats, the filled part is the prefix until the ring wraps
+	return transform_residuals(matr, window_touch_x_.data(), window_touch_y_.data(),
+		window_point_x_.data(), window_point_y_.data(), window_count_);
+}
+
+double drift_estimator_t::divergence_px() const
+{
+	const double corners[4][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+	double max = 0;
+	for (size_t idx = 0; idx < corner_raw_.size(); ++idx)
+	{
+		vec2<double> xy = rls_.predict(corner_raw_[idx] / corner_raw_[idx][2]);
+		double dx = (xy[0] - corners[idx][0]) * width_;
+		double dy = (xy[1] - corners[idx][1]) * height_;
+		max = std::max(max, std::sqrt(dx * dx + dy * dy));
+	}
+	return max;
+}
+
+// Owner only: samples rewrite the calibration. The mode is set after bind, a sender
+// of another user may have been quick, every datagram carries its credentials too.
+static int socket_open(const char* socket_path)
+{
+	int fd = unix_socket_bind(socket_path, SOCK_DGRAM | SOCK_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	int on = 1;
+	if (chmod(socket_path, S_IRUSR | S_IWUSR) != 0 ||
+		setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)) != 0)
+	{
+		ERR("failed: chmod() / setsockopt(SO_PASSCRED): %s : %s", socket_path, strerror(errno));
+		close(fd);
+		unix_socket_unlink(socket_path);
+		return -1;
+	}
+	return fd;
+}
+
+bool drift_monitor_run(Display* display, int deviceid, const char* socket_path, const drift_config_t& config)
+{
+	transform_matrix_t current{};
+	if (!get_matrix(display, deviceid, current))
+	{
+		ERR("failed: get_matrix()");
+		return false;
+	}
+	int screen_num = DefaultScreen(display);
+	drift_estimator_t estimator(current, DisplayWidth(display, screen_num), DisplayHeight(display, screen_num), config);
+
+	int fd = socket_open(socket_path);
+	if (fd < 0)
+		return false;
+	LOG("listening: %s current matrix: %s", socket_path, transform_matrix_to_str(current).c_str());
+
+	char buf[128];
+	for (;;)
+	{
+		ucred cred{};
+		ssize_t len = unix_socket_recv(fd, buf, sizeof(buf) - 1, cred);
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ERR("failed: recvmsg(): %s", strerror(errno));
+			break;
+		}
+		if (!unix_socket_peer_allowed(cred))
+			continue;
+		buf[len] = '\0';
+		xy_t target{};
+		xy_t event{};
+		if (sscanf(buf, "%d %d %d %d", &target.x, &target.y, &event.x, &event.y) != 4)
+		{
+			ERR("bad sample: %s", buf);
+			continue;
+		}
+		if (!estimator.add_sample(target, event))
+			continue;
+
+		transform_matrix_t matr = estimator.estimate();
+		residual_stats_t old_fit = estimator.window_residuals(current);
+		residual_stats_t new_fit = estimator.window_residuals(matr);
+		LOG("drift %f px, recent taps rms: %g -> %g, new matrix: %s", estimator.divergence_px(),
+			old_fit.rms, new_fit.rms, transform_matrix_to_str(matr).c_str());
+		if (!set_matrix(display, deviceid, matr))
+		{
+			ERR("failed: set_matrix()");
+			break;
+		}
+		estimator.set_current(matr);
+		current = matr;
+	}
+	close(fd);
+	unix_socket_unlink(socket_path);
+	return false;
+}
@@ -0,0 +1,68 @@
+#ifndef DRIFT_MONITOR_H
+#define DRIFT_MONITOR_H
+
+#include "common.h"
+#include "point_transform.h"
+#include "rls.h"
+#include "transform_matrix.h"
+
+#include <X11/Xlib.h>
+
+#include <array>
+
+struct drift_config_t
+{
+	double threshold_px = 10;   // update matrix when estimate moves any screen corner further
+	double outlier_px = 100;    // ignore taps further than this from the target
+	size_t min_samples = 20;    // samples before the first update
+	double lambda = 0.999;      // RLS forgetting factor
+	double p0 = 0.1;            // RLS initial covariance, small - trust current matrix
+	double p_max = 1;           // RLS covariance trace bound: taps on few buttons do not wind it up
+	double max_step_px = 50;    // reject estimates moving any screen corner further in one update
+};
+
+// Recent accepted samples scored against a matrix.
+constexpr size_t drift_window = 256;
+
+// Online estimate of the touch -> screen mapping from ordinary taps on known targets.
+struct drift_estimator_t
+{
+	drift_estimator_t(const transform_matrix_t& current, int width, int height, const drift_config_t& config);
+
+	// target - hit target center, event - position the application got
+	// with the current matrix, both in screen pixels.
+	// Returns true if estimate diverged from the current matrix beyond threshold
+	// and is plausible: valid, within max_step_px, fits recent taps not worse.
+	// Implausible estimate is dropped, estimation restarts from the current matrix.
+	bool add_sample(xy_t target, xy_t event);
+	transform_matrix_t estimate() const;
+	// Largest displacement of screen corners between estimate and current matrix, pixels.
+	double divergence_px() const;
+	// Matrix applied to the device, following events are produced with it.
+	void set_current(const transform_matrix_t& matr);
+	// Residuals of matr over the recent samples window, normalized screen units.
+	residual_stats_t window_residuals(const transform_matrix_t& matr) const;
+
+	drift_config_t config_;
+	int width_;
+	int height_;
+	transform_matrix_t current_;
+	rls_t<3, 2, double> rls_;
+	mat33<double> current_inv_;
+	std::array<vec3<double>, 4> corner_raw_;  // raw touch coordinates of screen corners
+	size_t samples_;
+	// raw touch and expected screen position, normalized, ring buffer of drift_window
+	std::array<float, drift_window> window_touch_x_;
+	std::array<float, drift_window> window_touch_y_;
+	std::array<float, drift_window> window_point_x_;
+	std::array<float, drift_window> window_point_y_;
+	size_t window_count_;
+	size_t window_next_;
+};
+
+// Background mode: receives "target_x target_y event_x event_y" datagrams
+// on unix socket and sets updated matrix to the device when it drifts.
+// Returns only on error.
+bool drift_monitor_run(Display* display, int deviceid, const char* socket_path, const drift_config_t& config);
+
+#endif  // DRIFT_MONITOR_H
@@ -0,0 +1,189 @@
+#include "drift_monitor.h"
+#include "rls.h"
+#include "unix_socket.h"
+#include "log.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+bool verbose = false;
+
+constexpr int width = 1920;
+constexpr int height = 1080;
+
+// Taps on random targets, raw touch goes through drifted panel mapping
+// and then through the current (stale) matrix.
+xy_t tap_event(const mat33<double>& drift, const mat33<double>& current, xy_t target)
+{
+	vec2<double> raw = apply(drift, vec2<double>{{1. * target.x / width, 1. * target.y / height}});
+	vec2<double> screen = apply(current, raw);
+	return xy_t{
+		static_cast<coordinate_t>(std::lround(screen[0] * width)),
+		static_cast<coordinate_t>(std::lround(screen[1] * height))};
+}
+
+// All taps on three buttons in one corner: only a small region of the mapping is observed.
+// Every applied update stays within max_step_px and valid, RLS covariance stays bounded.
+void clustered_test()
+{
+	transform_matrix_t current = transform_matrix_identity();
+	mat33<double> drift{{
+		{0.99, 0.005, 0.01},
+		{0, 1.01, -0.008},
+		{0, 0, 1}}};
+	drift_config_t config{};
+	config.lambda = 0.99;  // fast tracking: covariance of unobserved directions grows fast
+	drift_estimator_t estimator(current, width, height, config);
+
+	const xy_t buttons[] = {{1700, 950}, {1800, 950}, {1800, 1020}};
+	std::mt19937 rng(2);
+	std::uniform_int_distribution<int> button(0, 2);
+	std::uniform_int_distribution<int> jitter(-15, 15);
+	std::normal_distribution<double> noise(0, 2);
+	int updates = 0;
+	for (int idx = 0; idx < 5000; ++idx)
+	{
+		xy_t target = buttons[button(rng)];
+		target.x += jitter(rng);
+		target.y += jitter(rng);
+		xy_t event = tap_event(drift, to_mat<double>(current), target);
+		event.x += std::lround(noise(rng));
+		event.y += std::lround(noise(rng));
+		ASSERT(estimator.rls_.p_trace() <= config.p_max * (1 + 1e-9));
+		if (!estimator.add_sample(target, event))
+			continue;
+		ASSERT(estimator.divergence_px() <= config.max_step_px);
+		current = estimator.estimate();
+		ASSERT(transform_matrix_valid(current));
+		estimator.set_current(current);
+		++updates;
+	}
+	printf("clustered updates: %d matrix: %s\n", updates, transform_matrix_to_str(current).c_str());
+	// unbounded covariance makes the estimate jump around on noise: dozens of updates
+	ASSERT(updates > 0 && updates < 10);
+
+	// taps on the buttons land where they shall
+	vec2<double> center{{1750. / width, 985. / height}};
+	vec2<double> tapped = apply(to_mat<double>(current), apply(drift, center));
+	ASSERT(std::fabs(tapped[0] - center[0]) * width < 3 && std::fabs(tapped[1] - center[1]) * height < 3);
+	// far corner not thrown away
+	vec2<double> corner = apply(to_mat<double>(current), apply(drift, vec2<double>{{0, 0}}));
+	printf("corner: %f %f px\n", corner[0] * width, corner[1] * height);
+	ASSERT(std::fabs(corner[0]) * width < 100 && std::fabs(corner[1]) * height < 100);
+}
+
+// Stale socket replaced, live one refused, other files kept, sender credentials received.
+void socket_test()
+{
+	char dir[] = "/tmp/drift_test.XXXXXX";
+	ASSERT(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/drift.sock";
+
+	int fd = unix_socket_bind(path.c_str(), SOCK_DGRAM | SOCK_CLOEXEC);
+	ASSERT(fd >= 0);
+	// second instance while the first is bound
+	ASSERT(unix_socket_bind(path.c_str(), SOCK_DGRAM) < 0);
+	struct stat st{};
+	ASSERT(stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode));
+
+	int on = 1;
+	ASSERT(setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)) == 0);
+	int sender = socket(AF_UNIX, SOCK_DGRAM, 0);
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	ASSERT(sendto(sender, "1 2 3 4", 7, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 7);
+	char buf[16];
+	ucred cred{};
+	ASSERT(unix_socket_recv(fd, buf, sizeof(buf), cred) == 7);
+	ASSERT(cred.uid == geteuid() && cred.pid == getpid() && unix_socket_peer_allowed(cred));
+	ASSERT(!unix_socket_peer_allowed(ucred{1, geteuid() + 1, 0}));
+	close(sender);
+
+	// first instance gone without unlink: stale socket is replaced
+	close(fd);
+	fd = unix_socket_bind(path.c_str(), SOCK_DGRAM);
+	ASSERT(fd >= 0);
+	close(fd);
+	unix_socket_unlink(path.c_str());
+
+	// regular file at the path is left alone
+	FILE* fh = fopen(path.c_str(), "w");
+	ASSERT(fh != nullptr);
+	fclose(fh);
+	ASSERT(unix_socket_bind(path.c_str(), SOCK_DGRAM) < 0);
+	unix_socket_unlink(path.c_str());
+	ASSERT(stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode));
+	ASSERT(unlink(path.c_str()) == 0);
+	ASSERT(rmdir(dir) == 0);
+}
+
+int main()
+{
+	socket_test();
+
+	// RLS converges to exact linear model
+	rls_t<3, 1, double> rls(mat<3, 1, double>::zero(), 1e6, 1);
+	for (int idx = 0; idx < 50; ++idx)
+	{
+		vec3<double> x{{1. * (idx % 7), 1. * (idx % 5), 1}};
+		rls.update(x, vec<1, double>{{2 * x[0] - 3 * x[1] + 0.5}});
+	}
+	ASSERT(std::fabs(rls.theta.m[0][0] - 2) < 1e-4);
+	ASSERT(std::fabs(rls.theta.m[1][0] + 3) < 1e-4);
+	ASSERT(std::fabs(rls.theta.m[2][0] - 0.5) < 1e-4);
+
+	// panel drifted: raw touch = drift * screen, current matrix is identity
+	transform_matrix_t current = transform_matrix_identity();
+	mat33<double> drift{{
+		{0.98, 0.01, 0.015},
+		{-0.005, 1.02, -0.01},
+		{0, 0, 1}}};
+	drift_config_t config{};
+	drift_estimator_t estimator(current, width, height, config);
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> target_x(50, width - 50);
+	std::uniform_int_distribution<int> target_y(50, height - 50);
+	std::normal_distribution<double> noise(0, 2);
+	int updates = 0;
+	for (int idx = 0; idx < 2000; ++idx)
+	{
+		xy_t target{target_x(rng), target_y(rng)};
+		xy_t event = tap_event(drift, to_mat<double>(current), target);
+		event.x += std::lround(noise(rng));
+		event.y += std::lround(noise(rng));
+		if (idx % 100 == 0)  // misclick
+			event.x += 300;
+		if (!estimator.add_sample(target, event))
+			continue;
+		current = estimator.estimate();
+		estimator.set_current(current);
+		++updates;
+	}
+
+	// current * drift shall be close to identity now
+	transform_matrix_t residual = transform_matrix_compose(current, to_transform_matrix(drift));
+	printf("updates: %d residual: %s\n", updates, transform_matrix_to_str(residual).c_str());
+	ASSERT(updates > 0);
+	for (size_t row = 0; row < 2; ++row)
+		for (size_t col = 0; col < 3; ++col)
+			ASSERT(std::fabs(residual[row * 3 + col] - (row == col ? 1 : 0)) < 5e-3);
+	ASSERT(estimator.divergence_px() < config.threshold_px);
+	// recent taps fit the tracked matrix better than the stale one
+	residual_stats_t stale = estimator.window_residuals(transform_matrix_identity());
+	residual_stats_t tracked = estimator.window_residuals(current);
+	ASSERT(stale.count == drift_window && tracked.rms < stale.rms);
+
+	clustered_test();
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,299 @@
+// End-to-end test: starts Xvfb, runs "xorg_calibrator fake verbose" on it
+// and injects presses with XTest at known distortion of the drawn targets.
+// Checks the recovered matrix and measures injected press to
+// "sample accepted" latency.
+
+#include "matrix.h"
+#include "log.h"
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+bool verbose = false;
+
+using clock_type = std::chrono::steady_clock;
+
+struct e2e_config_t
+{
+	std::string calibrator = "./xorg_calibrator";
+	int width = 1280;
+	int height = 800;
+	int sessions = 10;
+	double max_p95_ms = 250;
+	double tolerance = 3e-3;
+};
+
+e2e_config_t parse_opts(int argc, const char* argv[])
+{
+	e2e_config_t config{};
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		std::string opt = argv[idx];
+		size_t eq = opt.find('=');
+		std::string key = opt.substr(0, eq);
+		std::string val = eq == std::string::npos ? "" : opt.substr(eq + 1);
+		if (key == "calibrator")
+			config.calibrator = val;
+		else if (key == "sessions")
+			config.sessions = strtol(val.c_str(), NULL, 10);
+		else if (key == "max_p95_ms")
+			config.max_p95_ms = strtod(val.c_str(), NULL);
+		else if (key == "verbose")
+			verbose = true;
+	}
+	return config;
+}
+
+pid_t spawn(const std::vector<std::string>& args, int* stdout_fd)
+{
+	int pipe_fd[2] = {-1, -1};
+	if (stdout_fd != nullptr && pipe(pipe_fd) != 0)
+		return -1;
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		if (stdout_fd != nullptr)
+		{
+			dup2(pipe_fd[1], STDOUT_FILENO);
+			close(pipe_fd[0]);
+			close(pipe_fd[1]);
+		}
+		std::vector<char*> argv;
+		for (const auto& arg : args)
+			argv.push_back(const_cast<char*>(arg.c_str()));
+		argv.push_back(nullptr);
+		execvp(argv[0], argv.data());
+		_exit(127);
+	}
+	if (stdout_fd != nullptr)
+	{
+		close(pipe_fd[1]);
+		*stdout_fd = pipe_fd[0];
+	}
+	return pid;
+}
+
+// Reads one line from child stdout, false on timeout or EOF.
+bool line_read(int fd, std::string& buf, std::string& line, int timeout_ms)
+{
+	auto deadline = clock_type::now() + std::chrono::milliseconds(timeout_ms);
+	for (;;)
+	{
+		size_t pos = buf.find('\n');
+		if (pos != std::string::npos)
+		{
+			line = buf.substr(0, pos);
+			buf.erase(0, pos + 1);
+			return true;
+		}
+		int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock_type::now()).count();
+		if (left <= 0)
+			return false;
+		pollfd pfd{fd, POLLIN, 0};
+		if (poll(&pfd, 1, left) <= 0)
+			return false;
+		char chunk[256];
+		ssize_t len = read(fd, chunk, sizeof(chunk));
+		if (len <= 0)
+			return false;
+		buf.append(chunk, len);
+	}
+}
+
+// Xvfb on the first free display: it writes the display number to the
+// -displayfd pipe once it accepts connections. Returns Xvfb pid, -1 on failure.
+pid_t xvfb_start(const e2e_config_t& config, std::string& display)
+{
+	int pipe_fd[2] = {-1, -1};
+	if (pipe(pipe_fd) != 0)
+	{
+		ERR("failed: pipe(): %s", strerror(errno));
+		return -1;
+	}
+	std::string screen = std::to_string(config.width) + "x" + std::to_string(config.height) + "x24";
+	pid_t pid = spawn({"Xvfb", "-displayfd", std::to_string(pipe_fd[1]), "-screen", "0", screen,
+		"-nolisten", "tcp"}, nullptr);
+	close(pipe_fd[1]);
+	std::string buf;
+	std::string line;
+	bool started = pid >= 0 && line_read(pipe_fd[0], buf, line, 10000) && !line.empty();
+	close(pipe_fd[0]);
+	if (!started)
+	{
+		ERR("failed: Xvfb did not report a display");
+		if (pid >= 0)
+		{
+			kill(pid, SIGTERM);
+			waitpid(pid, nullptr, 0);
+		}
+		return -1;
+	}
+	display = ":" + line;
+	LOG("Xvfb display: %s", display.c_str());
+	return pid;
+}
+
+void press(Display* display, int x, int y)
+{
+	XTestFakeMotionEvent(display, DefaultScreen(display), x, y, CurrentTime);
+	XTestFakeButtonEvent(display, 1, True, CurrentTime);
+	XTestFakeButtonEvent(display, 1, False, CurrentTime);
+	XFlush(display);
+}
+
+// One calibration session, returns false on failure.
+bool session_run(const e2e_config_t& config, Display* display, const mat33<double>& distortion,
+	std::vector<double>& latency_ms, std::array<float, 9>& matrix)
+{
+	int fd = -1;
+	pid_t pid = spawn({config.calibrator, "fake", "verbose"}, &fd);
+	if (pid < 0)
+	{
+		ERR("failed: spawn(): %s", config.calibrator.c_str());
+		return false;
+	}
+	std::string buf;
+	std::string line;
+	clock_type::time_point pressed{};
+	int matrix_items = 0;
+	while (line_read(fd, buf, line, 5000))
+	{
+		LOG("%s", line.c_str());
+		int idx = 0;
+		int x = 0;
+		int y = 0;
+		const char* shown = strstr(line.c_str(), "target shown ");
+		const char* accepted = strstr(line.c_str(), "sample accepted ");
+		const char* option = strstr(line.c_str(), "\"TransformationMatrix\"");
+		if (shown && sscanf(shown, "target shown %d: %d:%d", &idx, &x, &y) == 3)
+		{
+			vec2<double> xy = apply(distortion, vec2<double>{{1. * x / config.width, 1. * y / config.height}});
+			pressed = clock_type::now();
+			press(display, std::lround(xy[0] * config.width), std::lround(xy[1] * config.height));
+		}
+		else if (accepted)
+			latency_ms.push_back(std::chrono::duration<double, std::milli>(clock_type::now() - pressed).count());
+		else if (option)
+		{
+			const char* values = strchr(option + strlen("\"TransformationMatrix\""), '"');
+			if (values)
+				matrix_items = sscanf(values, "\"%f %f %f %f %f %f %f %f %f\"",
+					&matrix[0], &matrix[1], &matrix[2], &matrix[3], &matrix[4],
+					&matrix[5], &matrix[6], &matrix[7], &matrix[8]);
+		}
+	}
+	close(fd);
+	int status = 0;
+	pid_t exited = 0;
+	for (int idx = 0; idx < 40 && exited == 0; ++idx)
+	{
+		exited = waitpid(pid, &status, WNOHANG);
+		if (exited == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+	if (exited == 0)
+	{
+		ERR("calibrator hangs");
+		kill(pid, SIGTERM);
+		waitpid(pid, &status, 0);
+		return false;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		ERR("calibrator failed, status: %d", status);
+		return false;
+	}
+	if (matrix_items != 9)
+	{
+		ERR("no matrix in calibrator output");
+		return false;
+	}
+	return true;
+}
+
+double percentile(std::vector<double> values, double pct)
+{
+	if (values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	size_t rank = static_cast<size_t>(std::ceil(pct / 100 * values.size()));
+	return values[std::max<size_t>(rank, 1) - 1];
+}
+
+int main(int argc, const char* argv[])
+{
+	e2e_config_t config = parse_opts(argc, argv);
+	std::string display_name;
+	pid_t xvfb = xvfb_start(config, display_name);
+	if (xvfb < 0)
+		return EXIT_FAILURE;
+	Display* display = XOpenDisplay(display_name.c_str());
+	if (display == nullptr)
+	{
+		ERR("failed: XOpenDisplay(): %s", display_name.c_str());
+		kill(xvfb, SIGTERM);
+		return EXIT_FAILURE;
+	}
+	int event_base, error_base, major, minor;
+	if (!XTestQueryExtension(display, &event_base, &error_base, &major, &minor))
+	{
+		ERR("XTest extension not available");
+		kill(xvfb, SIGTERM);
+		return EXIT_FAILURE;
+	}
+	setenv("DISPLAY", display_name.c_str(), 1);
+
+	// panel maps screen to touch with scale and offset, calibrator shall find inverse
+	mat33<double> distortion{{
+		{0.96, 0, 0.03},
+		{0, 1.04, -0.025},
+		{0, 0, 1}}};
+	mat33<double> expected{};
+	inverse(distortion, expected);
+
+	bool ok = true;
+	std::vector<double> latency_ms;
+	for (int session = 0; session < config.sessions && ok; ++session)
+	{
+		std::array<float, 9> matrix{};
+		ok = session_run(config, display, distortion, latency_ms, matrix);
+		for (size_t idx = 0; ok && idx < matrix.size(); ++idx)
+			if (std::fabs(matrix[idx] - expected.m[idx / 3][idx % 3]) > config.tolerance)
+			{
+				ERR("session %d matrix[%zu]: %f expected: %f", session, idx, matrix[idx], expected.m[idx / 3][idx % 3]);
+				ok = false;
+			}
+	}
+	XCloseDisplay(display);
+	kill(xvfb, SIGTERM);
+	waitpid(xvfb, nullptr, 0);
+
+	double p95 = percentile(latency_ms, 95);
+	printf("{\"sessions\":%d,\"samples\":%zu,\"latency_ms\":{\"p50\":%.2f,\"p95\":%.2f,\"p99\":%.2f,\"max\":%.2f}}\n",
+		config.sessions, latency_ms.size(),
+		percentile(latency_ms, 50), p95, percentile(latency_ms, 99), percentile(latency_ms, 100));
+	if (ok && p95 > config.max_p95_ms)
+	{
+		ERR("latency p95 %.2f ms is over %.2f ms", p95, config.max_p95_ms);
+		ok = false;
+	}
+	printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
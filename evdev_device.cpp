@@ -0,0 +1,143 @@
+#include "evdev_device.h"
+#include "log.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+static bool axis_get(int fd, int code, evdev_axis_t& axis)
+{
+	input_absinfo absinfo{};
+	if (ioctl(fd, EVIOCGABS(code), &absinfo) != 0 || absinfo.maximum <= absinfo.minimum)
+		return false;
+	axis = evdev_axis_t{code, absinfo.minimum, absinfo.maximum};
+	return true;
+}
+
+bool evdev_open(const std::string& node, evdev_device_t& device)
+{
+	device = evdev_device_t{};
+	device.fd = open(node.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (device.fd < 0)
+	{
+		ERR("failed: open(): %s : %s", node.c_str(), strerror(errno));
+		return false;
+	}
+	// single touch axes, multitouch only devices report slots only
+	if (!(axis_get(device.fd, ABS_X, device.x) && axis_get(device.fd, ABS_Y, device.y)) &&
+		!(axis_get(device.fd, ABS_MT_POSITION_X, device.x) && axis_get(device.fd, ABS_MT_POSITION_Y, device.y)))
+	{
+		ERR("failed: EVIOCGABS: %s has no absolute X and Y axes", node.c_str());
+		evdev_close(device);
+		return false;
+	}
+	// timestamps comparable with std::chrono::steady_clock
+	int clock_id = CLOCK_MONOTONIC;
+	if (ioctl(device.fd, EVIOCSCLOCKID, &clock_id) != 0)
+		LOG("EVIOCSCLOCKID failed, timestamps are CLOCK_REALTIME: %s", strerror(errno));
+	LOG("%s x: %d..%d y: %d..%d", node.c_str(), device.x.min, device.x.max, device.y.min, device.y.max);
+	return true;
+}
+
+void evdev_close(evdev_device_t& device)
+{
+	if (device.fd >= 0)
+		close(device.fd);
+	device.fd = -1;
+}
+
+double evdev_map(const evdev_axis_t& axis, int raw, int size)
+{
+	if (axis.max <= axis.min)
+		return raw;
+	return 1. * (raw - axis.min) * size / (axis.max - axis.min + 1);
+}
+
+bool evdev_event(evdev_device_t& device, const input_event& event, int width, int height,
+	evdev_touch_t& touch)
+{
+	if (event.type == EV_SYN && event.code == SYN_DROPPED)
+	{
+		// events lost, state is unknown until the next report
+		device.dropped = true;
+		device.press_pending = false;
+		return false;
+	}
+	if (device.dropped)
+	{
+		if (event.type == EV_SYN && event.code == SYN_REPORT)
+			device.dropped = false;
+		return false;
+	}
+	if (event.type == EV_ABS)
+	{
+		if (event.code == device.x.code)
+			device.raw.x = event.value;
+		else if (event.code == device.y.code)
+			device.raw.y = event.value;
+	}
+	else if (event.type == EV_KEY && (event.code == BTN_TOUCH || event.code == BTN_LEFT))
+	{
+		if (event.value == 1 && !device.pressed)
+			device.press_pending = true;
+		device.pressed = event.value != 0;
+	}
+	else if (event.type == EV_SYN && event.code == SYN_REPORT)
+	{
+		if (!device.press_pending || device.raw.x < 0 || device.raw.y < 0)
+			return false;
+		device.press_pending = false;
+		touch.raw = device.raw;
+		touch.xy = touch_xy_t{
+			evdev_map(device.x, device.raw.x, width),
+			evdev_map(device.y, device.raw.y, height)};
+		touch.time.tv_sec = event.input_event_sec;
+		touch.time.tv_usec = event.input_event_usec;
+		return true;
+	}
+	return false;
+}
+
+int evdev_touch_wait(evdev_device_t& device, int width, int height, evdev_touch_t& touch, int timeout_ms)
+{
+	for (;;)
+	{
+		while (device.buf_pos < device.buf_len)
+			if (evdev_event(device, device.buf[device.buf_pos++], width, height, touch))
+				return 1;
+
+		pollfd pfd{device.fd, POLLIN, 0};
+		int rc = poll(&pfd, 1, timeout_ms);
+		if (rc < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ERR("failed: poll(): %s", strerror(errno));
+			return -1;
+		}
+		if (rc == 0)
+			return 0;
+		ssize_t len = read(device.fd, device.buf.data(), sizeof(device.buf));
+		if (len < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (len <= 0)
+		{
+			if (len < 0)
+				ERR("failed: read(): %s", strerror(errno));
+			return -1;
+		}
+		if (len % sizeof(input_event) != 0)
+		{
+			ERR("failed: read(): partial input_event");
+			return -1;
+		}
+		device.buf_pos = 0;
+		device.buf_len = len / sizeof(input_event);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef EVDEV_DEVICE_H
+#define EVDEV_DEVICE_H
+
+// Touches read directly from the kernel evdev node of the device,
+// bypassing X event dispatch. Works on any fd carrying struct input_event,
+// so recorded streams and pipes can be replayed in tests.
+
+#include "common.h"
+
+#include <linux/input.h>
+
+#include <array>
+#include <string>
+
+struct evdev_axis_t
+{
+	int code;   // ABS_X / ABS_MT_POSITION_X ...
+	int min;
+	int max;
+};
+
+struct evdev_touch_t
+{
+	touch_xy_t xy;   // screen pixels, fractional
+	xy_t raw;        // digitizer units
+	timeval time;    // kernel timestamp of the SYN_REPORT, CLOCK_MONOTONIC if set
+};
+
+struct evdev_device_t
+{
+	int fd = -1;
+	evdev_axis_t x{ABS_X, 0, 0};
+	evdev_axis_t y{ABS_Y, 0, 0};
+	// event stream state
+	xy_t raw{-1, -1};
+	bool pressed = false;
+	bool press_pending = false;
+	bool dropped = false;
+	// events read but not fed yet
+	std::array<input_event, 64> buf;
+	size_t buf_len = 0;
+	size_t buf_pos = 0;
+};
+
+// Opens the node and gets axis ranges, returns false on error.
+bool evdev_open(const std::string& node, evdev_device_t& device);
+void evdev_close(evdev_device_t& device);
+
+// Digitizer units to screen pixels through the axis range, not rounded:
+// digitizers have finer resolution than the screen.
+double evdev_map(const evdev_axis_t& axis, int raw, int size);
+
+// Feeds one event, returns true when it completes a touch press.
+bool evdev_event(evdev_device_t& device, const input_event& event, int width, int height,
+	evdev_touch_t& touch);
+
+// Waits up to timeout_ms (-1 - forever) for the next touch press.
+// Returns 1 on touch, 0 on timeout, -1 on error or end of stream.
+int evdev_touch_wait(evdev_device_t& device, int width, int height, evdev_touch_t& touch, int timeout_ms);
+
+#endif  // EVDEV_DEVICE_H
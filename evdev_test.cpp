@@ -0,0 +1,158 @@
+#include "evdev_device.h"
+#include "log.h"
+
+#include <linux/uinput.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+bool verbose = false;
+
+constexpr int width = 1920;
+constexpr int height = 1080;
+constexpr int axis_max = 4095;
+
+input_event ev(long sec, long usec, int type, int code, int value)
+{
+	input_event event{};
+	event.input_event_sec = sec;
+	event.input_event_usec = usec;
+	event.type = type;
+	event.code = code;
+	event.value = value;
+	return event;
+}
+
+bool write_events(int fd, const std::vector<input_event>& events)
+{
+	size_t size = events.size() * sizeof(input_event);
+	return write(fd, events.data(), size) == static_cast<ssize_t>(size);
+}
+
+// Recorded stream replayed through a pipe.
+void recorded_stream_test()
+{
+	int pipe_fd[2];
+	ASSERT(pipe(pipe_fd) == 0);
+	evdev_device_t device{};
+	device.fd = pipe_fd[0];
+	device.x = evdev_axis_t{ABS_X, 0, axis_max};
+	device.y = evdev_axis_t{ABS_Y, 0, axis_max};
+
+	ASSERT(write_events(pipe_fd[1], {
+		// hover, no press
+		ev(1, 0, EV_ABS, ABS_X, 1000), ev(1, 0, EV_ABS, ABS_Y, 2000), ev(1, 0, EV_SYN, SYN_REPORT, 0),
+		// press
+		ev(2, 500, EV_KEY, BTN_TOUCH, 1), ev(2, 500, EV_SYN, SYN_REPORT, 0),
+		// move while pressed, release
+		ev(3, 0, EV_ABS, ABS_X, 1100), ev(3, 0, EV_SYN, SYN_REPORT, 0),
+		ev(4, 0, EV_KEY, BTN_TOUCH, 0), ev(4, 0, EV_SYN, SYN_REPORT, 0),
+		// press in a dropped frame is lost
+		ev(5, 0, EV_SYN, SYN_DROPPED, 0),
+		ev(5, 0, EV_KEY, BTN_TOUCH, 1), ev(5, 0, EV_ABS, ABS_X, 0), ev(5, 0, EV_SYN, SYN_REPORT, 0),
+		ev(6, 0, EV_KEY, BTN_TOUCH, 0), ev(6, 0, EV_SYN, SYN_REPORT, 0),
+		// press with new position in the same frame
+		ev(7, 250, EV_KEY, BTN_TOUCH, 1), ev(7, 250, EV_ABS, ABS_X, 3000), ev(7, 250, EV_ABS, ABS_Y, axis_max),
+		ev(7, 250, EV_SYN, SYN_REPORT, 0),
+		}));
+
+	evdev_touch_t touch{};
+	ASSERT(evdev_touch_wait(device, width, height, touch, 1000) == 1);
+	ASSERT(touch.raw.x == 1000 && touch.raw.y == 2000);
+	ASSERT(touch.xy.x == evdev_map(device.x, 1000, width) && touch.xy.y == evdev_map(device.y, 2000, height));
+	ASSERT(touch.time.tv_sec == 2 && touch.time.tv_usec == 500);
+
+	ASSERT(evdev_touch_wait(device, width, height, touch, 1000) == 1);
+	ASSERT(touch.raw.x == 3000 && touch.raw.y == axis_max);
+	ASSERT(touch.time.tv_sec == 7 && touch.time.tv_usec == 250);
+
+	// nothing more: timeout, then end of stream
+	ASSERT(evdev_touch_wait(device, width, height, touch, 10) == 0);
+	close(pipe_fd[1]);
+	ASSERT(evdev_touch_wait(device, width, height, touch, 1000) == -1);
+	evdev_close(device);
+}
+
+// Virtual device through uinput, skipped without access to /dev/uinput.
+void uinput_test()
+{
+	int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		printf("uinput test skipped: /dev/uinput: %s\n", strerror(errno));
+		return;
+	}
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(fd, UI_SET_KEYBIT, BTN_TOUCH);
+	ioctl(fd, UI_SET_EVBIT, EV_ABS);
+	ioctl(fd, UI_SET_ABSBIT, ABS_X);
+	ioctl(fd, UI_SET_ABSBIT, ABS_Y);
+	ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT);
+	uinput_user_dev dev{};
+	snprintf(dev.name, sizeof(dev.name), "xorg_calibrator evdev_test");
+	dev.id.bustype = BUS_VIRTUAL;
+	dev.absmax[ABS_X] = axis_max;
+	dev.absmax[ABS_Y] = axis_max;
+	ASSERT(write(fd, &dev, sizeof(dev)) == sizeof(dev));
+	ASSERT(ioctl(fd, UI_DEV_CREATE) == 0);
+
+	char sysname[64]{};
+	ASSERT(ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) >= 0);
+	std::string sys_dir = std::string("/sys/devices/virtual/input/") + sysname;
+	std::string node;
+	for (int idx = 0; idx < 32 && node.empty(); ++idx)
+		if (access((sys_dir + "/event" + std::to_string(idx)).c_str(), F_OK) == 0)
+			node = "/dev/input/event" + std::to_string(idx);
+	ASSERT(!node.empty());
+
+	// udev creates the node asynchronously
+	evdev_device_t device{};
+	bool opened = false;
+	for (int idx = 0; idx < 50 && !opened; ++idx)
+	{
+		opened = access(node.c_str(), R_OK) == 0 && evdev_open(node, device);
+		if (!opened)
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	ASSERT(opened);
+	ASSERT(device.x.code == ABS_X && device.x.max == axis_max);
+
+	ASSERT(write_events(fd, {
+		ev(0, 0, EV_ABS, ABS_X, 2048), ev(0, 0, EV_ABS, ABS_Y, 1024),
+		ev(0, 0, EV_KEY, BTN_TOUCH, 1), ev(0, 0, EV_SYN, SYN_REPORT, 0),
+		}));
+	evdev_touch_t touch{};
+	ASSERT(evdev_touch_wait(device, width, height, touch, 1000) == 1);
+	ASSERT(touch.xy.x == width / 2 && touch.xy.y == height / 4);
+	ASSERT(touch.time.tv_sec != 0 || touch.time.tv_usec != 0);
+
+	evdev_close(device);
+	ioctl(fd, UI_DEV_DESTROY);
+	close(fd);
+	printf("uinput test OK\n");
+}
+
+int main()
+{
+	evdev_axis_t axis{ABS_X, 0, axis_max};
+	ASSERT(evdev_map(axis, 0, width) == 0);
+	ASSERT(evdev_map(axis, 2048, width) == width / 2);
+	// sub-pixel position is kept
+	ASSERT(evdev_map(axis, 2049, width) == width / 2 + 1. * width / (axis_max + 1));
+	evdev_axis_t offset_axis{ABS_Y, 100, 1099};
+	ASSERT(evdev_map(offset_axis, 100, 1000) == 0);
+	ASSERT(evdev_map(offset_axis, 600, 1000) == 500);
+
+	recorded_stream_test();
+	uinput_test();
+	printf("OK\n");
+	return 0;
+}
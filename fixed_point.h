@@ -0,0 +1,115 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+// Fixed point scalar for the transform math on CPUs without FPU,
+// usable as T of the matrix.h templates and of the solvers.
+// raw holds the value scaled by 2^Frac, Wide holds products and quotients
+// before they are rounded back. Out of range results saturate instead of
+// wrapping, division by zero saturates too.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+template <typename Int, typename Wide, int Frac>
+struct fixed_t
+{
+	static_assert(sizeof(Wide) >= 2 * sizeof(Int), "Wide shall hold products of Int");
+
+	static constexpr int scale_bits = Frac;
+
+	Int raw;
+
+	constexpr fixed_t() : raw(0) {}
+	constexpr explicit fixed_t(int val) : raw(saturate(Wide(val) * scale())) {}
+	// Rounded to nearest. Floating point is used only here and in the casts below.
+	explicit fixed_t(double val) : raw(round_double(std::ldexp(val, Frac))) {}
+
+	static constexpr fixed_t from_raw(Int raw)
+	{
+		fixed_t res;
+		res.raw = raw;
+		return res;
+	}
+
+	explicit operator double() const { return std::ldexp(static_cast<double>(raw), -Frac); }
+	// Integer to float conversion rounds once and scaling by power of two is exact,
+	// so the result is the float nearest to the fixed point value.
+	explicit operator float() const { return std::ldexp(static_cast<float>(raw), -Frac); }
+
+	static constexpr Wide scale() { return Wide(1) << Frac; }
+
+	static constexpr Int saturate(Wide val)
+	{
+		return val > Wide(std::numeric_limits<Int>::max()) ? std::numeric_limits<Int>::max() :
+			val < Wide(std::numeric_limits<Int>::min()) ? std::numeric_limits<Int>::min() :
+			static_cast<Int>(val);
+	}
+
+	static Int round_double(double val)
+	{
+		const double limit = std::ldexp(1., std::numeric_limits<Int>::digits);
+		if (val != val)
+			return 0;
+		if (val >= limit)
+			return std::numeric_limits<Int>::max();
+		if (val <= -limit)
+			return std::numeric_limits<Int>::min();
+		return static_cast<Int>(std::llround(val));
+	}
+
+	friend constexpr fixed_t operator + (fixed_t a, fixed_t b) { return from_raw(saturate(Wide(a.raw) + b.raw)); }
+	friend constexpr fixed_t operator - (fixed_t a, fixed_t b) { return from_raw(saturate(Wide(a.raw) - b.raw)); }
+	friend constexpr fixed_t operator - (fixed_t a) { return from_raw(saturate(-Wide(a.raw))); }
+
+	// Rounded to nearest, arithmetic right shift of negative values assumed (gcc, clang).
+	friend constexpr fixed_t operator * (fixed_t a, fixed_t b)
+	{
+		return from_raw(saturate((Wide(a.raw) * b.raw + scale() / 2) >> Frac));
+	}
+
+	friend constexpr fixed_t operator / (fixed_t a, fixed_t b)
+	{
+		if (b.raw == 0)
+			return from_raw(a.raw < 0 ? std::numeric_limits<Int>::min() : std::numeric_limits<Int>::max());
+		Wide num = Wide(a.raw) * scale();
+		Wide den = b.raw;
+		Wide half = (den < 0 ? -den : den) / 2;
+		// quotient truncates toward zero, rounded to nearest by half of the divisor
+		num += (num < 0) == (den < 0) ? half : -half;
+		return from_raw(saturate(num / den));
+	}
+
+	constexpr fixed_t& operator += (fixed_t b) { return *this = *this + b; }
+	constexpr fixed_t& operator -= (fixed_t b) { return *this = *this - b; }
+	constexpr fixed_t& operator *= (fixed_t b) { return *this = *this * b; }
+	constexpr fixed_t& operator /= (fixed_t b) { return *this = *this / b; }
+
+	friend constexpr bool operator == (fixed_t a, fixed_t b) { return a.raw == b.raw; }
+	friend constexpr bool operator != (fixed_t a, fixed_t b) { return a.raw != b.raw; }
+	friend constexpr bool operator < (fixed_t a, fixed_t b) { return a.raw < b.raw; }
+	friend constexpr bool operator > (fixed_t a, fixed_t b) { return a.raw > b.raw; }
+	friend constexpr bool operator <= (fixed_t a, fixed_t b) { return a.raw <= b.raw; }
+	friend constexpr bool operator >= (fixed_t a, fixed_t b) { return a.raw >= b.raw; }
+};
+
+// Q16.16: range +-32768, resolution 1.5e-5, 64 bit products.
+using q16_16_t = fixed_t<int32_t, int64_t, 16>;
+// Q32.32: range +-2^31, resolution 2.3e-10, 128 bit products (gcc, clang).
+using q32_32_t = fixed_t<int64_t, __int128, 32>;
+
+// Pivot or determinant magnitude the solvers treat as zero:
+// exact zero for floating point, rounding noise for fixed point.
+template <typename T>
+struct scalar_traits
+{
+	static constexpr T singular() { return T(0); }
+};
+
+template <typename Int, typename Wide, int Frac>
+struct scalar_traits<fixed_t<Int, Wide, Frac>>
+{
+	static constexpr fixed_t<Int, Wide, Frac> singular() { return fixed_t<Int, Wide, Frac>::from_raw(16); }
+};
+
+#endif  // FIXED_POINT_H
@@ -0,0 +1,86 @@
+#include "fixed_point.h"
+#include "transform_matrix.h"
+#include "log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+bool verbose = false;
+
+constexpr int width = 1920;
+constexpr int height = 1080;
+
+// Sum of the results keeps the compiler from dropping the loops.
+float sink = 0;
+
+double elapsed_sec(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T>
+void bench(const char* name, size_t solves, size_t points)
+{
+	touch_point_list_t corners{{
+		{{213, 120}, {230, 104}},
+		{{1707, 120}, {1690, 131}},
+		{{213, 960}, {219, 975}},
+		{{1707, 960}, {1722, 949}}}};
+	std::vector<touch_point_t> grid;
+	for (int row = 0; row < 3; ++row)
+		for (int col = 0; col < 3; ++col)
+			grid.push_back(touch_point_t{{213 + col * 747, 120 + row * 420},
+				{219. + col * 741 + row * 3, 111. + row * 426 - col * 2}});
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < solves; ++idx)
+	{
+		corners[UL].touch.x = 230 + idx % 8;
+		sink += transform_matrix_solve<T>(corners, width, height)[2];
+	}
+	double four_point_sec = elapsed_sec(start);
+
+	start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < solves; ++idx)
+	{
+		grid[0].touch.x = 219 + idx % 8;
+		sink += transform_matrix_lsq_solve<T>(grid.data(), grid.size(), width, height)[2];
+	}
+	double lsq_sec = elapsed_sec(start);
+
+	// point pipeline: raw touch to screen pixels
+	mat33<T> matr = to_mat<T>(transform_matrix_solve<T>(corners, width, height));
+	std::vector<T> x(points);
+	std::vector<T> y(points);
+	for (size_t idx = 0; idx < points; ++idx)
+	{
+		x[idx] = T(static_cast<int>(idx % width)) / T(width);
+		y[idx] = T(static_cast<int>(idx % height)) / T(height);
+	}
+	std::vector<T> out_x(points);
+	std::vector<T> out_y(points);
+	start = std::chrono::steady_clock::now();
+	apply(matr, x.data(), y.data(), out_x.data(), out_y.data(), points);
+	double apply_sec = elapsed_sec(start);
+	sink += static_cast<float>(out_x[points / 2]);
+
+	printf("%-7s 4-point: %8.0f ns  lsq(9): %8.0f ns  apply: %8.1f Mpoints/s\n", name,
+		four_point_sec / solves * 1e9, lsq_sec / solves * 1e9, points / apply_sec / 1e6);
+}
+
+// Usage: ./fixed_point_bench [solves] [points]
+// Run on the target: on CPUs with FPU double is usually the fastest,
+// without FPU it goes through soft-float calls.
+int main(int argc, const char* argv[])
+{
+	size_t solves = argc > 1 ? strtoul(argv[1], NULL, 10) : 200 * 1000;
+	size_t points = argc > 2 ? strtoul(argv[2], NULL, 10) : 10 * 1000 * 1000;
+	printf("solves: %zu points: %zu\n", solves, points);
+	bench<double>("double", solves, points);
+	bench<q32_32_t>("Q32.32", solves, points);
+	bench<q16_16_t>("Q16.16", solves, points);
+	LOG("sink: %f", sink);
+	return 0;
+}
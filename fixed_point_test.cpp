@@ -0,0 +1,187 @@
+#include "fixed_point.h"
+#include "transform_matrix.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+bool verbose = false;
+
+constexpr int width = 1920;
+constexpr int height = 1080;
+
+template <typename T>
+void arithmetic_test()
+{
+	ASSERT(T(3) / T(4) == T(0.75));
+	ASSERT(T(-3) / T(4) == T(-0.75));
+	ASSERT(T(3) * T(-0.5) == T(-1.5));
+	ASSERT(T(1) - T(3) == T(-2));
+	ASSERT(-T(2) < T(0) && abs_val(T(-2)) == T(2));
+	// rounded to nearest: 1/3 is within half of the resolution
+	double third = static_cast<double>(T(1) / T(3));
+	ASSERT(std::fabs(third - 1. / 3) <= std::ldexp(0.5, -T::scale_bits));
+	// saturation, no wrap around
+	T max = T::from_raw(std::numeric_limits<decltype(T::raw)>::max());
+	ASSERT(max + T(1) == max);
+	ASSERT(max * T(2) == max);
+	ASSERT(-max * T(2) < T(0));
+	ASSERT(T(1) / T(0) == max);
+	ASSERT(T(1e30) == max);
+	ASSERT(T(0) / T(0) == max);
+}
+
+// Float conversion is the correctly rounded value of the fixed point number:
+// long double holds 64 bit raw exactly on x86, it is rounded once to float.
+template <typename T>
+void float_conversion_test()
+{
+	using raw_t = decltype(T::raw);
+	std::mt19937_64 rng(5);
+	std::uniform_int_distribution<raw_t> raw_dist(std::numeric_limits<raw_t>::min(), std::numeric_limits<raw_t>::max());
+	for (int idx = 0; idx < 100000; ++idx)
+	{
+		// small values too, the matrix entries are around 1
+		raw_t raw = raw_dist(rng) >> (idx % 40);
+		T val = T::from_raw(raw);
+		float reference = static_cast<float>(std::ldexp(static_cast<long double>(raw), -T::scale_bits));
+		ASSERT(static_cast<float>(val) == reference);
+		// 32 bit raw fits double mantissa
+		if (sizeof(raw_t) == 4)
+			ASSERT(static_cast<double>(val) == std::ldexp(static_cast<double>(raw), -T::scale_bits));
+	}
+	// floats with fitting mantissa survive the round trip
+	for (float val : {0.f, 1.f, -1.f, 0.5f, 1.000244140625f, -0.0078125f, 1234.5f})
+		ASSERT(static_cast<float>(T(val)) == val);
+}
+
+// Largest screen pixel distance between two matrices over a grid.
+double max_distance_px(const transform_matrix_t& a, const transform_matrix_t& b)
+{
+	double max = 0;
+	for (int row = 0; row <= 8; ++row)
+		for (int col = 0; col <= 8; ++col)
+		{
+			vec2<double> xy{{col / 8., row / 8.}};
+			vec2<double> pa = apply(to_mat<double>(a), xy);
+			vec2<double> pb = apply(to_mat<double>(b), xy);
+			max = std::max(max, std::hypot((pa[0] - pb[0]) * width, (pa[1] - pb[1]) * height));
+		}
+	return max;
+}
+
+struct error_bounds_t
+{
+	double four_point_px;
+	double lsq_px;
+};
+
+// Random panel distortions, fixed point solvers against the double reference.
+template <typename T>
+error_bounds_t solver_error(int trials)
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<double> scale(0.85, 1.15);
+	std::uniform_real_distribution<double> skew(-0.05, 0.05);
+	std::uniform_real_distribution<double> offset(-0.08, 0.08);
+	std::normal_distribution<double> noise(0, 3);
+	error_bounds_t max{0, 0};
+	for (int trial = 0; trial < trials; ++trial)
+	{
+		mat33<double> distortion{{
+			{scale(rng), skew(rng), offset(rng)},
+			{skew(rng), scale(rng), offset(rng)},
+			{0, 0, 1}}};
+		std::array<touch_point_t, 9> touch_point_list{};
+		for (size_t idx = 0; idx < touch_point_list.size(); ++idx)
+		{
+			xy_t point{width / 9 + static_cast<int>(idx % 3) * width * 7 / 18,
+				height / 9 + static_cast<int>(idx / 3) * height * 7 / 18};
+			vec2<double> touch = apply(distortion, vec2<double>{{1. * point.x / width, 1. * point.y / height}});
+			touch_point_list[idx] = touch_point_t{point, touch_xy_t{
+				touch[0] * width + noise(rng),
+				touch[1] * height + noise(rng)}};
+		}
+		touch_point_list_t corners{touch_point_list[0], touch_point_list[2], touch_point_list[6], touch_point_list[8]};
+		transform_matrix_t reference = transform_matrix_solve<double>(corners, width, height);
+		transform_matrix_t fixed = transform_matrix_solve<T>(corners, width, height);
+		ASSERT(transform_matrix_valid(reference) && transform_matrix_valid(fixed));
+		max.four_point_px = std::max(max.four_point_px, max_distance_px(reference, fixed));
+
+		reference = transform_matrix_lsq_solve<double>(touch_point_list.data(), touch_point_list.size(), width, height);
+		fixed = transform_matrix_lsq_solve<T>(touch_point_list.data(), touch_point_list.size(), width, height);
+		ASSERT(transform_matrix_valid(reference) && transform_matrix_valid(fixed));
+		max.lsq_px = std::max(max.lsq_px, max_distance_px(reference, fixed));
+	}
+	return max;
+}
+
+// double relies on exact zero pivots (rounding of this line is not), fixed point
+// on the determinant limit
+template <typename T>
+void singular_test()
+{
+	// all touches on one line
+	std::array<touch_point_t, 5> line{};
+	for (size_t idx = 0; idx < line.size(); ++idx)
+		line[idx] = touch_point_t{{static_cast<int>(idx) * 300, static_cast<int>(idx) * 200},
+			{idx * 301., idx * 199.}};
+	ASSERT(!transform_matrix_valid(transform_matrix_lsq_solve<T>(line.data(), line.size(), width, height)));
+	// every touch at the same place
+	touch_point_list_t same{};
+	for (auto& touch_point : same)
+		touch_point.touch = {500, 500};
+	same[UL].point = {213, 120};
+	same[UR].point = {1707, 120};
+	same[LR].point = {1707, 960};
+	ASSERT(!transform_matrix_valid(transform_matrix_solve<T>(same, width, height)));
+}
+
+// Point pipeline in fixed point against double.
+template <typename T>
+double apply_error_px(const transform_matrix_t& matr)
+{
+	mat33<T> fixed = to_mat<T>(matr);
+	mat33<double> reference = to_mat<double>(matr);
+	double max = 0;
+	for (int y = 0; y <= height; y += 60)
+		for (int x = 0; x <= width; x += 60)
+		{
+			vec2<T> p = apply(fixed, vec2<T>{{T(x) / T(width), T(y) / T(height)}});
+			vec2<double> r = apply(reference, vec2<double>{{1. * x / width, 1. * y / height}});
+			max = std::max(max, std::hypot((static_cast<double>(p[0]) - r[0]) * width,
+				(static_cast<double>(p[1]) - r[1]) * height));
+		}
+	return max;
+}
+
+int main()
+{
+	arithmetic_test<q16_16_t>();
+	arithmetic_test<q32_32_t>();
+	float_conversion_test<q16_16_t>();
+	float_conversion_test<q32_32_t>();
+	singular_test<q16_16_t>();
+	singular_test<q32_32_t>();
+
+	constexpr int trials = 2000;
+	error_bounds_t q16 = solver_error<q16_16_t>(trials);
+	error_bounds_t q32 = solver_error<q32_32_t>(trials);
+	printf("max error vs double, px: Q16.16 4-point: %.4f lsq: %.4f  Q32.32 4-point: %.6f lsq: %.6f\n",
+		q16.four_point_px, q16.lsq_px, q32.four_point_px, q32.lsq_px);
+	// Q16.16 resolution is 1.5e-5 of the screen (0.03 px), rounding accumulates in the solvers
+	ASSERT(q16.four_point_px < 0.25 && q16.lsq_px < 0.5);
+	// Q32.32 is limited by the float output
+	ASSERT(q32.four_point_px < 1e-3 && q32.lsq_px < 1e-3);
+
+	transform_matrix_t matr{1.02f, 0.01f, -0.01f, -0.02f, 0.98f, 0.015f, 0, 0, 1};
+	double q16_apply = apply_error_px<q16_16_t>(matr);
+	double q32_apply = apply_error_px<q32_32_t>(matr);
+	printf("apply max error vs double, px: Q16.16: %.4f Q32.32: %.6f\n", q16_apply, q32_apply);
+	ASSERT(q16_apply < 0.1 && q32_apply < 1e-4);
+
+	printf("OK\n");
+	return 0;
+}
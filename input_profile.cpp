@@ -0,0 +1,282 @@
+#include "input_profile.h"
+#include "log.h"
+
+#include <X11/extensions/XInput2.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <ctime>
+
+#include <sys/select.h>
+
+double input_latency_ms(const input_sample_t& sample)
+{
+	constexpr double wrap = 4294967296.;
+	double diff = std::fmod(sample.receive_ms - sample.server_ms, wrap);
+	if (diff > wrap / 2)
+		diff -= wrap;
+	else if (diff < -wrap / 2)
+		diff += wrap;
+	return diff;
+}
+
+// Nearest rank of the sorted values.
+static double percentile(const std::vector<double>& sorted, double share)
+{
+	size_t rank = static_cast<size_t>(std::ceil(share * sorted.size()));
+	return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+input_stream_stats_t input_stream_stats(const std::vector<input_sample_t>& samples, double window_s)
+{
+	input_stream_stats_t stats{};
+	stats.count = samples.size();
+	stats.rate_hz = window_s > 0 ? samples.size() / window_s : 0;
+	if (samples.empty())
+		return stats;
+
+	std::vector<double> latency;
+	latency.reserve(samples.size());
+	for (const auto& sample : samples)
+		latency.push_back(input_latency_ms(sample));
+	std::sort(latency.begin(), latency.end());
+	stats.latency_p50_ms = percentile(latency, 0.5);
+	stats.latency_p90_ms = percentile(latency, 0.9);
+	stats.latency_p99_ms = percentile(latency, 0.99);
+	stats.latency_max_ms = latency.back();
+	// e.g. remote display: server clock has nothing to do with ours
+	stats.clock_comparable = std::fabs(stats.latency_p50_ms) < 60 * 1000;
+
+	size_t batched = 0;
+	size_t same_time = 0;
+	double interval_sum = 0;
+	double jitter_sum = 0;
+	for (size_t idx = 0; idx < samples.size(); ++idx)
+	{
+		bool prev_batch = idx > 0 && samples[idx - 1].batch == samples[idx].batch;
+		bool next_batch = idx + 1 < samples.size() && samples[idx + 1].batch == samples[idx].batch;
+		if (prev_batch || next_batch)
+			++batched;
+		if (idx == 0)
+			continue;
+		// server time difference is right across the wrap
+		int32_t server_interval = static_cast<int32_t>(samples[idx].server_ms - samples[idx - 1].server_ms);
+		double receive_interval = samples[idx].receive_ms - samples[idx - 1].receive_ms;
+		if (server_interval == 0)
+			++same_time;
+		interval_sum += server_interval;
+		jitter_sum += std::fabs(receive_interval - server_interval);
+	}
+	stats.batched = 1. * batched / samples.size();
+	if (samples.size() > 1)
+	{
+		stats.same_time = 1. * same_time / (samples.size() - 1);
+		stats.interval_ms = interval_sum / (samples.size() - 1);
+		stats.jitter_ms = jitter_sum / (samples.size() - 1);
+	}
+	return stats;
+}
+
+static double monotonic_ms()
+{
+	timespec now{};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+static bool x_error = false;
+
+static int x_error_handler(Display* display, XErrorEvent* event)
+{
+	char text[256];
+	XGetErrorText(display, event->error_code, text, sizeof(text));
+	ERR("X error: %s request: %d.%d", text, event->request_code, event->minor_code);
+	x_error = true;
+	return 0;
+}
+
+// Selection on the root window, no events - deselect. False if the server refused it,
+// e.g. touch events are selected on root by another client already.
+static bool select_events(Display* display, int deviceid, const int* events, size_t count)
+{
+	std::array<unsigned char, XIMaskLen(XI_LASTEVENT)> bits{};
+	for (size_t idx = 0; idx < count; ++idx)
+		XISetMask(bits.data(), events[idx]);
+	XIEventMask mask{deviceid, count > 0 ? static_cast<int>(bits.size()) : 0, bits.data()};
+	x_error = false;
+	XErrorHandler handler = XSetErrorHandler(x_error_handler);
+	XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+	XSync(display, False);
+	XSetErrorHandler(handler);
+	return !x_error;
+}
+
+static input_stream_t event_stream(int evtype)
+{
+	switch (evtype)
+	{
+	case XI_RawMotion:
+	case XI_RawButtonPress:
+	case XI_RawButtonRelease:
+	case XI_RawTouchBegin:
+	case XI_RawTouchUpdate:
+	case XI_RawTouchEnd:
+		return INPUT_RAW;
+	case XI_Motion:
+	case XI_ButtonPress:
+	case XI_ButtonRelease:
+	case XI_TouchBegin:
+	case XI_TouchUpdate:
+	case XI_TouchEnd:
+		return INPUT_COOKED;
+	default:
+		return INPUT_STREAM_END;
+	}
+}
+
+// Events of the device from one socket read, receive_ms is taken right after it.
+// Queued events only are drained: XPending() would read the socket again and
+// stamp later events with the time of this batch.
+static void events_read(Display* display, int xi_opcode, int device_id, uint32_t batch,
+	input_profile_t& profile)
+{
+	XEventsQueued(display, QueuedAfterReading);
+	double receive_ms = monotonic_ms();
+	while (XEventsQueued(display, QueuedAlready) > 0)
+	{
+		XEvent event;
+		XNextEvent(display, &event);
+		if (event.type != GenericEvent || event.xcookie.extension != xi_opcode ||
+			!XGetEventData(display, &event.xcookie))
+			continue;
+		input_stream_t stream = event_stream(event.xcookie.evtype);
+		// raw and device events start with the same fields
+		const XIDeviceEvent* device_event = static_cast<const XIDeviceEvent*>(event.xcookie.data);
+		if (stream != INPUT_STREAM_END && device_event->sourceid == device_id)
+			profile.samples[stream].push_back(input_sample_t{
+				static_cast<uint32_t>(device_event->time), receive_ms, batch});
+		XFreeEventData(display, &event.xcookie);
+	}
+}
+
+bool input_profile_capture(Display* display, int device_id, double window_s, input_profile_t& profile)
+{
+	int xi_opcode, event_base, error_base;
+	if (!XQueryExtension(display, "XInputExtension", &xi_opcode, &event_base, &error_base))
+	{
+		ERR("failed: XQueryExtension(): no XInputExtension");
+		return false;
+	}
+	int major = 2;
+	int minor = 2;
+	if (XIQueryVersion(display, &major, &minor) != Success || major < 2)
+	{
+		ERR("failed: XIQueryVersion(): XI %d.%d, profile needs 2.0", major, minor);
+		return false;
+	}
+	bool touch = major * 100 + minor >= 202;
+	LOG("XI %d.%d device: %d window: %f s", major, minor, device_id, window_s);
+
+	const int raw_events[] = {XI_RawMotion, XI_RawButtonPress, XI_RawButtonRelease,
+		XI_RawTouchBegin, XI_RawTouchUpdate, XI_RawTouchEnd};
+	const int cooked_events[] = {XI_Motion, XI_ButtonPress, XI_ButtonRelease,
+		XI_TouchBegin, XI_TouchUpdate, XI_TouchEnd};
+	// touch events are the last three
+	size_t raw_count = touch ? 6 : 3;
+	size_t cooked_count = raw_count;
+	if (!select_events(display, device_id, raw_events, raw_count))
+		return false;
+	// one client only may select touch events on a window
+	if (!select_events(display, XIAllMasterDevices, cooked_events, cooked_count))
+	{
+		if (touch)
+		{
+			ERR("Warning: touch events are taken by another client, cooked touch events are not profiled");
+			cooked_count = 3;
+		}
+		if (!touch || !select_events(display, XIAllMasterDevices, cooked_events, cooked_count))
+			ERR("Warning: cooked events selection failed, cooked events are not profiled");
+	}
+
+	profile.device_id = device_id;
+	profile.window_s = window_s;
+	for (auto& samples : profile.samples)
+		samples.clear();
+	int x_fd = ConnectionNumber(display);
+	double end_ms = monotonic_ms() + window_s * 1e3;
+	for (uint32_t batch = 0; ; ++batch)
+	{
+		events_read(display, xi_opcode, device_id, batch, profile);
+		int left_ms = static_cast<int>(std::ceil(end_ms - monotonic_ms()));
+		if (left_ms <= 0)
+			break;
+		fd_set read_fds;
+		FD_ZERO(&read_fds);
+		FD_SET(x_fd, &read_fds);
+		timeval timeout{left_ms / 1000, (left_ms % 1000) * 1000};
+		select(x_fd + 1, &read_fds, nullptr, nullptr, &timeout);
+	}
+
+	select_events(display, device_id, raw_events, 0);
+	select_events(display, XIAllMasterDevices, cooked_events, 0);
+	LOG("raw: %zu cooked: %zu", profile.samples[INPUT_RAW].size(), profile.samples[INPUT_COOKED].size());
+	return true;
+}
+
+// JSON has no infinity or NaN, null is used instead.
+static void json_number(text_buf_t& out, const char* key, double val, bool valid = true)
+{
+	if (valid && std::isfinite(val))
+		out.printf("\"%s\":%.3f", key, val);
+	else
+		out.printf("\"%s\":null", key);
+}
+
+static void stream_json(const input_stream_stats_t& stats, text_buf_t& out)
+{
+	// latency of an empty stream or of a foreign clock means nothing
+	bool latency = stats.count > 0 && stats.clock_comparable;
+	out.printf("{\"count\":%zu,", stats.count);
+	json_number(out, "rate_hz", stats.rate_hz);
+	out.append(",\"latency_ms\":{");
+	json_number(out, "p50", stats.latency_p50_ms, latency);
+	out.append(",");
+	json_number(out, "p90", stats.latency_p90_ms, latency);
+	out.append(",");
+	json_number(out, "p99", stats.latency_p99_ms, latency);
+	out.append(",");
+	json_number(out, "max", stats.latency_max_ms, latency);
+	out.append("},");
+	json_number(out, "interval_ms", stats.interval_ms, stats.count > 1);
+	out.append(",");
+	json_number(out, "jitter_ms", stats.jitter_ms, stats.count > 1);
+	out.append(",");
+	json_number(out, "batched", stats.batched);
+	out.append(",");
+	json_number(out, "same_time", stats.same_time);
+	out.append("}");
+}
+
+bool input_profile_json(const input_profile_t& profile, text_buf_t& out)
+{
+	std::array<input_stream_stats_t, INPUT_STREAM_END> stats;
+	for (size_t idx = 0; idx < stats.size(); ++idx)
+		stats[idx] = input_stream_stats(profile.samples[idx], profile.window_s);
+	out.printf("{\"device_id\":%d,\"device\":", profile.device_id);
+	out.append_json_str(profile.device_name.c_str());
+	out.append(",");
+	json_number(out, "window_s", profile.window_s);
+	out.append(",\"clock_comparable\":");
+	out.append(stats[INPUT_RAW].count > 0 && !stats[INPUT_RAW].clock_comparable ? "false" : "true");
+	out.append(",\"raw\":");
+	stream_json(stats[INPUT_RAW], out);
+	out.append(",\"cooked\":");
+	stream_json(stats[INPUT_COOKED], out);
+	out.append(",");
+	// below 1: motion merged by the server or events taken by client windows
+	json_number(out, "cooked_per_raw", 1. * stats[INPUT_COOKED].count / stats[INPUT_RAW].count,
+		stats[INPUT_RAW].count > 0);
+	out.append("}");
+	return !out.overflow();
+}
@@ -0,0 +1,71 @@
+#ifndef INPUT_PROFILE_H
+#define INPUT_PROFILE_H
+
+// Input pipeline latency profile of one device.
+// XI2 raw events (as the server got them from the driver) and cooked events
+// (transformed, as delivered to windows) are selected on the root window,
+// server event time is compared with the client receive time on CLOCK_MONOTONIC.
+// The X server stamps events with CLOCK_MONOTONIC milliseconds on Linux, so
+// latency is meaningful only for a local server, with 1 ms resolution.
+// Cooked events reach the root window only where no client window takes them.
+
+#include "text_buf.h"
+
+#include <X11/Xlib.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum input_stream_t
+{
+	INPUT_RAW = 0,
+	INPUT_COOKED,
+	INPUT_STREAM_END
+};
+
+struct input_sample_t
+{
+	uint32_t server_ms;   // X event time, wraps at 2^32
+	double receive_ms;    // CLOCK_MONOTONIC right after the socket read that got the event
+	uint32_t batch;       // events read after one wakeup share the batch
+};
+
+struct input_stream_stats_t
+{
+	size_t count;
+	double rate_hz;
+	double latency_p50_ms;
+	double latency_p90_ms;
+	double latency_p99_ms;
+	double latency_max_ms;
+	double interval_ms;   // mean server time between events
+	double jitter_ms;     // mean difference of receive and server intervals
+	double batched;       // share of events received together with others
+	double same_time;     // share of intervals with no server time difference
+	bool clock_comparable;  // latency within a minute: server clock is the local one
+};
+
+struct input_profile_t
+{
+	int device_id;
+	std::string device_name;
+	double window_s;
+	std::array<std::vector<input_sample_t>, INPUT_STREAM_END> samples;
+};
+
+// Receive time minus server time in ms, server time wrap handled.
+double input_latency_ms(const input_sample_t& sample);
+input_stream_stats_t input_stream_stats(const std::vector<input_sample_t>& samples, double window_s);
+
+// Captures events of device_id (slave device) for window_s seconds, needs XI 2.0,
+// touch events XI 2.2. Selection is removed afterwards.
+bool input_profile_capture(Display* display, int device_id, double window_s, input_profile_t& profile);
+
+// Appends JSON report, false if it does not fit.
+bool input_profile_json(const input_profile_t& profile, text_buf_t& out);
+
+using input_profile_json_storage_t = std::array<char, 2048>;
+
+#endif  // INPUT_PROFILE_H
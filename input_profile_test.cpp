@@ -0,0 +1,94 @@
+#include "input_profile.h"
+#include "log.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+bool verbose = false;
+
+bool near(double a, double b)
+{
+	return std::fabs(a - b) < 1e-9;
+}
+
+void latency_test()
+{
+	ASSERT(near(input_latency_ms(input_sample_t{1000, 1003.5, 0}), 3.5));
+	// server time wrapped, receive time did not
+	ASSERT(near(input_latency_ms(input_sample_t{4294967295u, 4294967296. + 2, 0}), 3));
+	ASSERT(near(input_latency_ms(input_sample_t{5, 4294967296. * 3 + 6, 0}), 1));
+}
+
+void stats_test()
+{
+	// 100 Hz digitizer across the server time wrap, latency 1..10 ms,
+	// every tenth report is read on the same wakeup as the one before
+	std::vector<input_sample_t> samples;
+	uint32_t batch = 0;
+	for (uint32_t idx = 0; idx < 100; ++idx)
+	{
+		double time_ms = 4294967295. - 500 + idx * 10;
+		double latency = 1 + idx % 10;
+		if (idx % 10 != 0)
+			++batch;
+		samples.push_back(input_sample_t{static_cast<uint32_t>(static_cast<uint64_t>(time_ms)),
+			4294967296. + time_ms + latency, batch});
+	}
+	input_stream_stats_t stats = input_stream_stats(samples, 1);
+	ASSERT(stats.count == 100 && near(stats.rate_hz, 100));
+	ASSERT(near(stats.latency_p50_ms, 5) && near(stats.latency_p90_ms, 9));
+	ASSERT(near(stats.latency_p99_ms, 10) && near(stats.latency_max_ms, 10));
+	ASSERT(stats.clock_comparable);
+	ASSERT(near(stats.interval_ms, 10));
+	// latency steps by 1 ms, drops by 9 ms after each tenth
+	ASSERT(near(stats.jitter_ms, (90 * 1. + 9 * 9.) / 99));
+	ASSERT(near(stats.batched, 0.18) && near(stats.same_time, 0));
+
+	// multi-touch frame: two contacts with one server time
+	samples = {{100, 102, 0}, {100, 102, 0}, {108, 111, 1}, {108, 111, 1}};
+	stats = input_stream_stats(samples, 2);
+	// two of three intervals have no server time difference
+	ASSERT(near(stats.rate_hz, 2) && near(stats.same_time, 2. / 3) && near(stats.batched, 1));
+
+	// remote server: clocks unrelated
+	samples = {{100, 5e6, 0}};
+	stats = input_stream_stats(samples, 1);
+	ASSERT(!stats.clock_comparable && near(stats.interval_ms, 0));
+
+	stats = input_stream_stats({}, 1);
+	ASSERT(stats.count == 0 && near(stats.rate_hz, 0));
+}
+
+void json_test()
+{
+	input_profile_t profile{};
+	profile.device_id = 11;
+	profile.device_name = "eGalax \"USB\" touch";
+	profile.window_s = 5;
+	profile.samples[INPUT_RAW] = {{100, 102, 0}, {108, 111, 1}};
+	input_profile_json_storage_t storage;
+	text_buf_t json(storage);
+	ASSERT(input_profile_json(profile, json));
+	ASSERT(strstr(json.c_str(), "\"device\":\"eGalax \\\"USB\\\" touch\"") != nullptr);
+	ASSERT(strstr(json.c_str(), "\"raw\":{\"count\":2,\"rate_hz\":0.400,\"latency_ms\":{\"p50\":2.000") != nullptr);
+	ASSERT(strstr(json.c_str(), "\"cooked\":{\"count\":0,\"rate_hz\":0.000,\"latency_ms\":{\"p50\":null") != nullptr);
+	ASSERT(strstr(json.c_str(), "\"cooked_per_raw\":0.000}") != nullptr);
+
+	// escaped name of 100 control characters fits, truncation is reported
+	profile.device_name = std::string(100, '\x01');
+	text_buf_t fit_json(storage);
+	ASSERT(input_profile_json(profile, fit_json));
+	profile.device_name = std::string(400, '\x01');
+	text_buf_t long_json(storage);
+	ASSERT(!input_profile_json(profile, long_json));
+}
+
+int main()
+{
+	latency_test();
+	stats_test();
+	json_test();
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,314 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+// Fixed size matrix and vector templates for the transform math.
+// Dimensions are template parameters, so loops have constant trip counts
+// and the compiler can fully unroll and vectorize them.
+
+#include <cmath>
+#include <cstddef>
+
+template <size_t N, typename T>
+struct vec
+{
+	T v[N];
+
+	constexpr T& operator [] (size_t idx) { return v[idx]; }
+	constexpr const T& operator [] (size_t idx) const { return v[idx]; }
+
+	static constexpr vec zero()
+	{
+		vec res{};
+		return res;
+	}
+};
+
+template <size_t N, size_t M, typename T>
+struct mat
+{
+	T m[N][M];
+
+	constexpr T& operator () (size_t row, size_t col) { return m[row][col]; }
+	constexpr const T& operator () (size_t row, size_t col) const { return m[row][col]; }
+
+	static constexpr mat zero()
+	{
+		mat res{};
+		return res;
+	}
+
+	static constexpr mat identity()
+	{
+		static_assert(N == M, "identity() needs square matrix");
+		mat res{};
+		for (size_t idx = 0; idx < N; ++idx)
+			res.m[idx][idx] = T(1);
+		return res;
+	}
+};
+
+template <typename T> using vec2 = vec<2, T>;
+template <typename T> using vec3 = vec<3, T>;
+template <typename T> using mat33 = mat<3, 3, T>;
+
+template <size_t N, typename T>
+constexpr vec<N, T> operator + (const vec<N, T>& a, const vec<N, T>& b)
+{
+	vec<N, T> res{};
+	for (size_t idx = 0; idx < N; ++idx)
+		res[idx] = a[idx] + b[idx];
+	return res;
+}
+
+template <size_t N, typename T>
+constexpr vec<N, T> operator - (const vec<N, T>& a, const vec<N, T>& b)
+{
+	vec<N, T> res{};
+	for (size_t idx = 0; idx < N; ++idx)
+		res[idx] = a[idx] - b[idx];
+	return res;
+}
+
+template <size_t N, typename T>
+constexpr vec<N, T> operator * (const vec<N, T>& a, T k)
+{
+	vec<N, T> res{};
+	for (size_t idx = 0; idx < N; ++idx)
+		res[idx] = a[idx] * k;
+	return res;
+}
+
+template <size_t N, typename T>
+constexpr vec<N, T> operator / (const vec<N, T>& a, T k)
+{
+	vec<N, T> res{};
+	for (size_t idx = 0; idx < N; ++idx)
+		res[idx] = a[idx] / k;
+	return res;
+}
+
+template <size_t N, typename T>
+constexpr T dot(const vec<N, T>& a, const vec<N, T>& b)
+{
+	T res = T(0);
+	for (size_t idx = 0; idx < N; ++idx)
+		res += a[idx] * b[idx];
+	return res;
+}
+
+// Composition: (a * b) applied to point is a applied to (b applied to point).
+template <size_t N, size_t K, size_t M, typename T>
+constexpr mat<N, M, T> operator * (const mat<N, K, T>& a, const mat<K, M, T>& b)
+{
+	mat<N, M, T> res{};
+	for (size_t row = 0; row < N; ++row)
+		for (size_t col = 0; col < M; ++col)
+		{
+			T sum = T(0);
+			for (size_t idx = 0; idx < K; ++idx)
+				sum += a.m[row][idx] * b.m[idx][col];
+			res.m[row][col] = sum;
+		}
+	return res;
+}
+
+template <size_t N, size_t M, typename T>
+constexpr vec<N, T> operator * (const mat<N, M, T>& a, const vec<M, T>& b)
+{
+	vec<N, T> res{};
+	for (size_t row = 0; row < N; ++row)
+	{
+		T sum = T(0);
+		for (size_t col = 0; col < M; ++col)
+			sum += a.m[row][col] * b[col];
+		res[row] = sum;
+	}
+	return res;
+}
+
+template <size_t N, size_t M, typename T>
+constexpr mat<M, N, T> transpose(const mat<N, M, T>& a)
+{
+	mat<M, N, T> res{};
+	for (size_t row = 0; row < N; ++row)
+		for (size_t col = 0; col < M; ++col)
+			res.m[col][row] = a.m[row][col];
+	return res;
+}
+
+template <typename To, size_t N, size_t M, typename From>
+constexpr mat<N, M, To> mat_cast(const mat<N, M, From>& a)
+{
+	mat<N, M, To> res{};
+	for (size_t row = 0; row < N; ++row)
+		for (size_t col = 0; col < M; ++col)
+			res.m[row][col] = static_cast<To>(a.m[row][col]);
+	return res;
+}
+
+template <typename T>
+constexpr T abs_val(T val)
+{
+	return val < T(0) ? -val : val;
+}
+
+// Gaussian elimination with partial pivoting.
+template <size_t N, typename T>
+constexpr T determinant(mat<N, N, T> a)
+{
+	T det = T(1);
+	for (size_t col = 0; col < N; ++col)
+	{
+		size_t pivot = col;
+		for (size_t row = col + 1; row < N; ++row)
+			if (abs_val(a.m[row][col]) > abs_val(a.m[pivot][col]))
+				pivot = row;
+		if (a.m[pivot][col] == T(0))
+			return T(0);
+		if (pivot != col)
+		{
+			for (size_t idx = 0; idx < N; ++idx)
+			{
+				T tmp = a.m[col][idx];
+				a.m[col][idx] = a.m[pivot][idx];
+				a.m[pivot][idx] = tmp;
+			}
+			det = -det;
+		}
+		det *= a.m[col][col];
+		for (size_t row = col + 1; row < N; ++row)
+		{
+			T k = a.m[row][col] / a.m[col][col];
+			for (size_t idx = col; idx < N; ++idx)
+				a.m[row][idx] -= k * a.m[col][idx];
+		}
+	}
+	return det;
+}
+
+// Solves a * x = b for every column of b (Gauss-Jordan, partial pivoting).
+// Returns false if a is singular.
+template <size_t N, size_t M, typename T>
+constexpr bool solve(mat<N, N, T> a, mat<N, M, T>& b)
+{
+	for (size_t col = 0; col < N; ++col)
+	{
+		size_t pivot = col;
+		for (size_t row = col + 1; row < N; ++row)
+			if (abs_val(a.m[row][col]) > abs_val(a.m[pivot][col]))
+				pivot = row;
+		if (a.m[pivot][col] == T(0))
+			return false;
+		if (pivot != col)
+		{
+			for (size_t idx = 0; idx < N; ++idx)
+			{
+				T tmp = a.m[col][idx];
+				a.m[col][idx] = a.m[pivot][idx];
+				a.m[pivot][idx] = tmp;
+			}
+			for (size_t idx = 0; idx < M; ++idx)
+			{
+				T tmp = b.m[col][idx];
+				b.m[col][idx] = b.m[pivot][idx];
+				b.m[pivot][idx] = tmp;
+			}
+		}
+		for (size_t row = 0; row < N; ++row)
+		{
+			if (row == col)
+				continue;
+			T k = a.m[row][col] / a.m[col][col];
+			for (size_t idx = col; idx < N; ++idx)
+				a.m[row][idx] -= k * a.m[col][idx];
+			for (size_t idx = 0; idx < M; ++idx)
+				b.m[row][idx] -= k * b.m[col][idx];
+		}
+	}
+	for (size_t row = 0; row < N; ++row)
+		for (size_t idx = 0; idx < M; ++idx)
+			b.m[row][idx] /= a.m[row][row];
+	return true;
+}
+
+template <size_t N, typename T>
+constexpr bool inverse(const mat<N, N, T>& a, mat<N, N, T>& inv)
+{
+	inv = mat<N, N, T>::identity();
+	return solve(a, inv);
+}
+
+// Eigenvalues of symmetric 3x3 matrix in ascending order (trigonometric method).
+template <typename T>
+vec3<T> symmetric_eigenvalues(const mat33<T>& a)
+{
+	T p1 = a.m[0][1] * a.m[0][1] + a.m[0][2] * a.m[0][2] + a.m[1][2] * a.m[1][2];
+	if (p1 == T(0))
+	{
+		vec3<T> diag{{a.m[0][0], a.m[1][1], a.m[2][2]}};
+		for (size_t idx = 0; idx < 2; ++idx)
+			for (size_t next = idx + 1; next < 3; ++next)
+				if (diag[next] < diag[idx])
+				{
+					T tmp = diag[idx];
+					diag[idx] = diag[next];
+					diag[next] = tmp;
+				}
+		return diag;
+	}
+	T q = (a.m[0][0] + a.m[1][1] + a.m[2][2]) / 3;
+	T p2 = (a.m[0][0] - q) * (a.m[0][0] - q) + (a.m[1][1] - q) * (a.m[1][1] - q) +
+		(a.m[2][2] - q) * (a.m[2][2] - q) + 2 * p1;
+	T p = std::sqrt(p2 / 6);
+	mat33<T> b = a;
+	for (size_t idx = 0; idx < 3; ++idx)
+		b.m[idx][idx] -= q;
+	T r = determinant(b) / (2 * p * p * p);
+	T phi = r <= T(-1) ? T(M_PI / 3) : r >= T(1) ? T(0) : std::acos(r) / 3;
+	T max = q + 2 * p * std::cos(phi);
+	T min = q + 2 * p * std::cos(phi + T(2 * M_PI / 3));
+	return vec3<T>{{min, 3 * q - max - min, max}};
+}
+
+// Homogeneous 2D point transform: (x, y, 1) -> (x', y') / w'.
+template <typename T>
+constexpr vec2<T> apply(const mat33<T>& a, const vec2<T>& xy)
+{
+	T x = a.m[0][0] * xy[0] + a.m[0][1] * xy[1] + a.m[0][2];
+	T y = a.m[1][0] * xy[0] + a.m[1][1] * xy[1] + a.m[1][2];
+	T w = a.m[2][0] * xy[0] + a.m[2][1] * xy[1] + a.m[2][2];
+	if (w != T(1))
+		return vec2<T>{{x / w, y / w}};
+	return vec2<T>{{x, y}};
+}
+
+// Batch point transform over separate x and y arrays.
+// Affine matrices (last row 0 0 1) skip the perspective division.
+template <typename T>
+void apply(const mat33<T>& a, const T* x, const T* y, T* out_x, T* out_y, size_t count)
+{
+	const T a00 = a.m[0][0], a01 = a.m[0][1], a02 = a.m[0][2];
+	const T a10 = a.m[1][0], a11 = a.m[1][1], a12 = a.m[1][2];
+	const T a20 = a.m[2][0], a21 = a.m[2][1], a22 = a.m[2][2];
+	if (a20 == T(0) && a21 == T(0) && a22 == T(1))
+	{
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			T px = x[idx];
+			T py = y[idx];
+			out_x[idx] = a00 * px + a01 * py + a02;
+			out_y[idx] = a10 * px + a11 * py + a12;
+		}
+		return;
+	}
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		T px = x[idx];
+		T py = y[idx];
+		T w = a20 * px + a21 * py + a22;
+		out_x[idx] = (a00 * px + a01 * py + a02) / w;
+		out_y[idx] = (a10 * px + a11 * py + a12) / w;
+	}
+}
+
+#endif  // MATRIX_H
@@ -0,0 +1,290 @@
+#include "matrix.h"
+#include "transform_matrix.h"
+#include "calibration_quality.h"
+#include "target_placement.h"
+#include "log.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+bool verbose = true;
+
+constexpr mat33<double> shear{{
+	{1, 2, 0},
+	{0, 1, 0},
+	{0, 0, 1}}};
+static_assert(determinant(shear) == 1, "constexpr determinant");
+static_assert((shear * mat33<double>::identity())(0, 1) == 2, "constexpr compose");
+
+bool near(double a, double b, double eps = 1e-4)
+{
+	return std::fabs(a - b) < eps;
+}
+
+bool near(const transform_matrix_t& a, const transform_matrix_t& b, double eps = 1e-4)
+{
+	for (size_t idx = 0; idx < a.size(); ++idx)
+		if (!near(a[idx], b[idx], eps))
+			return false;
+	return true;
+}
+
+constexpr int screen_width = 1920;
+constexpr int screen_height = 1080;
+
+transform_matrix_t lsq_solver(const touch_point_list_t& touch_point_list, int width, int height)
+{
+	return transform_matrix_lsq(touch_point_list.data(), touch_point_list.size(), width, height);
+}
+
+// Touches produced by a known distortion of the screen points
+// shall give matrix inverse to the distortion.
+void check_solver(transform_matrix_t (*solver)(const touch_point_list_t&, int, int),
+	const transform_matrix_t& distortion)
+{
+	transform_matrix_t expected{};
+	ASSERT(transform_matrix_inverse(distortion, expected));
+	ASSERT(near(transform_matrix_compose(expected, distortion), transform_matrix_identity()));
+
+	touch_point_list_t touch_point_list{};
+	int offset_x = screen_width / 9;
+	int offset_y = screen_height / 9;
+	touch_point_list[UL].point = {offset_x, offset_y};
+	touch_point_list[UR].point = {screen_width - offset_x, offset_y};
+	touch_point_list[LL].point = {offset_x, screen_height - offset_y};
+	touch_point_list[LR].point = {screen_width - offset_x, screen_height - offset_y};
+	mat33<double> dist = to_mat<double>(distortion);
+	for (auto& touch_point : touch_point_list)
+	{
+		vec2<double> xy = apply(dist, vec2<double>{{
+			1. * touch_point.point.x / screen_width,
+			1. * touch_point.point.y / screen_height}});
+		touch_point.touch = {xy[0] * screen_width, xy[1] * screen_height};
+	}
+
+	transform_matrix_t matr = solver(touch_point_list, screen_width, screen_height);
+	LOG("matrix: %s", transform_matrix_to_str(matr).c_str());
+	ASSERT(near(matr, expected, 2e-3));
+
+	calibration_quality_t quality = calibration_quality(touch_point_list.data(), touch_point_list.size(),
+		matr, screen_width, screen_height);
+	quality_json_storage_t storage;
+	text_buf_t json(storage);
+	ASSERT(calibration_quality_json(quality, json));
+	LOG("quality: %s", json.c_str());
+	ASSERT(quality.max_px < 2);
+	// sub-pixel touches of an exact panel: least squares leave-one-out fits are exact
+	ASSERT(quality.loo_max_px < 0.01);
+	ASSERT(quality.condition > 1 && std::isfinite(quality.condition));
+
+	// misclick shows in residual and leave-one-out error
+	touch_point_list[LR].touch.x += 40;
+	matr = solver(touch_point_list, screen_width, screen_height);
+	quality = calibration_quality(touch_point_list.data(), touch_point_list.size(),
+		matr, screen_width, screen_height);
+	json.clear();
+	ASSERT(calibration_quality_json(quality, json));
+	LOG("misclick quality: %s", json.c_str());
+	ASSERT(quality.max_px > 5 && quality.loo_max_px > 20);
+}
+
+// Touches of an exact panel with non-affine errors up to 2 * err_px,
+// targets taken until placement stops.
+size_t placement_run(target_placement_t& placement, int err_px)
+{
+	xy_t point{};
+	size_t count = 0;
+	while (placement.next(point))
+	{
+		int err = static_cast<int>((count * 7) % 5 - 2) * err_px;
+		ASSERT(placement.add(touch_xy_t{1. * point.x + err, 1. * point.y - err}));
+		++count;
+	}
+	return count;
+}
+
+// 4 point solver as it was before matrix.h, a..f written out: the vec2 one
+// shall give the same floats.
+transform_matrix_t solve_4point_reference(const touch_point_list_t& touch_point_list, int width, int height)
+{
+	double width_coef = 1. * touch_point_list[UL].point.x / width;
+	double height_coef = 1. *
+		(touch_point_list[LR].point.y - touch_point_list[UR].point.y)/
+		height;
+	std::array<vec2<double>, 4> clicks;
+	for (size_t idx = 0; idx < clicks.size(); ++idx)
+		clicks[idx] = vec2<double>{{touch_point_list[idx].touch.x / width, touch_point_list[idx].touch.y / height}};
+	double x0x = (clicks[0][0] + clicks[2][0]) / 2;
+	double x0y = (clicks[0][1] + clicks[2][1]) / 2;
+	double x1x = (clicks[1][0] + clicks[3][0]) / 2;
+	double x1y = (clicks[1][1] + clicks[3][1]) / 2;
+	double y0x = (clicks[0][0] + clicks[1][0]) / 2;
+	double y0y = (clicks[0][1] + clicks[1][1]) / 2;
+	double y1x = (clicks[2][0] + clicks[3][0]) / 2;
+	double y1y = (clicks[2][1] + clicks[3][1]) / 2;
+	double dxx = x1x - x0x;
+	double dxy = x1y - x0y;
+	double dyx = y1x - y0x;
+	double dyy = y1y - y0y;
+	double a = height_coef * (dxx / (( dxx *  dxx) + (dxy *  dxy)));
+	double b = height_coef * (dxy / (( dxx *  dxx) + (dxy *  dxy)));
+	double c = width_coef - (a * x0x) - (b *  x0y);
+	double d = height_coef * (dyx / ((dyx *  dyx) + (dyy *  dyy)));
+	double e = height_coef * (dyy / ((dyx *  dyx) + (dyy *  dyy)));
+	double f = width_coef - (d *  y0x) - (e *  y0y);
+	return transform_matrix_t{
+		static_cast<float>(a), static_cast<float>(b), static_cast<float>(c),
+		static_cast<float>(d), static_cast<float>(e), static_cast<float>(f),
+		0, 0, 1};
+}
+
+// Fixed pseudo random panels, whole and sub-pixel touches: exact float equality.
+void check_4point_reference()
+{
+	uint32_t state = 12345;
+	auto next = [&state](double range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return range * (static_cast<double>(state >> 8) / (1u << 24) - 0.5);
+	};
+	int offset_x = screen_width / 9;
+	int offset_y = screen_height / 9;
+	size_t mismatch = 0;
+	constexpr size_t cases = 10000;
+	// solver log of every case off
+	verbose = false;
+	for (size_t run = 0; run < cases; ++run)
+	{
+		touch_point_list_t touch_point_list{};
+		touch_point_list[UL].point = {offset_x, offset_y};
+		touch_point_list[UR].point = {screen_width - offset_x, offset_y};
+		touch_point_list[LL].point = {offset_x, screen_height - offset_y};
+		touch_point_list[LR].point = {screen_width - offset_x, screen_height - offset_y};
+		double scale_x = 1 + next(0.2);
+		double scale_y = 1 + next(0.2);
+		double shift_x = next(100);
+		double shift_y = next(100);
+		for (auto& touch_point : touch_point_list)
+		{
+			touch_point.touch = {touch_point.point.x * scale_x + shift_x + next(8),
+				touch_point.point.y * scale_y + shift_y + next(8)};
+			if (run % 2 == 0)
+				touch_point.touch = {std::round(touch_point.touch.x), std::round(touch_point.touch.y)};
+		}
+		transform_matrix_t expected = solve_4point_reference(touch_point_list, screen_width, screen_height);
+		transform_matrix_t matr = transform_matrix_solve<double>(touch_point_list, screen_width, screen_height);
+		if (matr != expected)
+			++mismatch;
+	}
+	verbose = true;
+	LOG("4 point solver: %zu of %zu differ from the reference", mismatch, cases);
+	ASSERT(mismatch == 0);
+}
+
+int main()
+{
+	mat33<double> a{{
+		{2, 1, 0},
+		{1, 3, 1},
+		{0, 1, 4}}};
+	ASSERT(near(determinant(a), 18));
+	mat33<double> inv{};
+	ASSERT(inverse(a, inv));
+	mat33<double> id = a * inv;
+	for (size_t row = 0; row < 3; ++row)
+		for (size_t col = 0; col < 3; ++col)
+			ASSERT(near(id(row, col), row == col ? 1 : 0));
+	ASSERT(!inverse(mat33<double>::zero(), inv));
+	vec3<double> eigen = symmetric_eigenvalues(a);
+	ASSERT(near(eigen[0] * eigen[1] * eigen[2], determinant(a)));
+	ASSERT(near(eigen[0] + eigen[1] + eigen[2], 9));
+	ASSERT(eigen[0] <= eigen[1] && eigen[1] <= eigen[2]);
+
+	// 4 point solver assumes no shear, least squares solver handles any affine
+	transform_matrix_t scale_offset{
+		0.97f, 0, 0.01f,
+		0, 1.03f, -0.02f,
+		0, 0, 1};
+	check_solver(transform_matrix, scale_offset);
+	check_solver(lsq_solver, scale_offset);
+	transform_matrix_t affine{
+		0.97f, 0.02f, 0.01f,
+		-0.01f, 1.03f, -0.02f,
+		0, 0, 1};
+	check_solver(lsq_solver, affine);
+	check_4point_reference();
+
+	touch_point_list_t touch_point_list{};
+	ASSERT(!transform_matrix_valid(transform_matrix_lsq(touch_point_list.data(), 2, screen_width, screen_height)));
+
+	// adaptive placement: corners first, exact panel stops there,
+	// noisy one gets more targets, first extra one is not the center
+	xy_t grid[25];
+	ASSERT(target_grid(screen_width, screen_height, 2, grid, 25) == 4);
+	const xy_t corners[] = {
+		{screen_width / 9, screen_height / 9},
+		{screen_width - screen_width / 9, screen_height / 9},
+		{screen_width / 9, screen_height - screen_height / 9},
+		{screen_width - screen_width / 9, screen_height - screen_height / 9}};
+	for (size_t idx = 0; idx < 4; ++idx)
+		ASSERT(grid[idx] == corners[idx]);
+
+	// parallel capture: touch matched to the nearest free target within half the spacing
+	ASSERT(target_grid(screen_width, screen_height, 3, grid, 25) == 9);
+	double radius = target_match_radius(grid, 9);
+	ASSERT(radius == (screen_height - 2 * (screen_height / 9)) / 4);
+	bool taken[9] = {};
+	ASSERT(target_nearest(grid, taken, 9, touch_xy_t{grid[4].x + 30., grid[4].y - 40.}, radius) == 4);
+	ASSERT(target_nearest(grid, taken, 9, touch_xy_t{(grid[0].x + grid[1].x) / 2., 1. * grid[0].y}, radius) == 9);
+	taken[8] = true;
+	ASSERT(target_nearest(grid, taken, 9, touch_xy_t{1. * grid[8].x, 1. * grid[8].y}, radius) == 9);
+	ASSERT(target_nearest(grid, taken, 9, touch_xy_t{1. * grid[7].x, 1. * grid[7].y}, radius) == 7);
+
+	// inverted X panel: raw touches are nearest to the mirrored targets,
+	// through the fit of three reference corners every touch finds its own target
+	std::array<touch_point_t, 9> mirrored{};
+	for (size_t idx = 0; idx < 9; ++idx)
+		mirrored[idx] = touch_point_t{grid[idx], touch_xy_t{screen_width - 1. * grid[idx].x + 3, grid[idx].y - 2.}};
+	std::array<touch_point_t, 3> reference{mirrored[0], mirrored[2], mirrored[6]};
+	transform_matrix_t provisional = transform_matrix_lsq(reference.data(), reference.size(), screen_width, screen_height);
+	ASSERT(transform_matrix_valid(provisional));
+	bool free_targets[9] = {};
+	ASSERT(target_nearest(grid, free_targets, 9, mirrored[3].touch, radius) == 5);
+	for (size_t idx = 0; idx < 9; ++idx)
+	{
+		touch_xy_t screen = target_predict(provisional, mirrored[idx].touch, screen_width, screen_height);
+		ASSERT(target_nearest(grid, free_targets, 9, screen, radius) == idx);
+	}
+	target_placement_t exact(screen_width, screen_height, 5, 1, 13);
+	ASSERT(placement_run(exact, 0) == 4);
+	ASSERT(exact.solved_ && exact.quality_.loo_rms_px < 1);
+	target_placement_t noisy(screen_width, screen_height, 5, 1, 5);
+	xy_t point{};
+	for (size_t idx = 0; idx < 4; ++idx)
+	{
+		ASSERT(noisy.next(point) && point == corners[idx]);
+		ASSERT(noisy.add(touch_xy_t{point.x + (idx == 3 ? 8. : 0.), 1. * point.y}));
+	}
+	ASSERT(noisy.next(point));
+	ASSERT(point != (xy_t{screen_width / 2, screen_height / 2}));
+	target_placement_t limit(screen_width, screen_height, 5, 0.1, 9);
+	ASSERT(placement_run(limit, 5) == 9);
+
+	mat33<double> dist = to_mat<double>(affine);
+	// batch transform matches single point transform
+	double x[5] = {0, 0.25, 0.5, 0.75, 1};
+	double y[5] = {1, 0.75, 0.5, 0.25, 0};
+	double out_x[5];
+	double out_y[5];
+	apply(dist, x, y, out_x, out_y, 5);
+	for (size_t idx = 0; idx < 5; ++idx)
+	{
+		vec2<double> xy = apply(dist, vec2<double>{{x[idx], y[idx]}});
+		ASSERT(near(out_x[idx], xy[0]) && near(out_y[idx], xy[1]));
+	}
+
+	printf("OK\n");
+	return 0;
+}
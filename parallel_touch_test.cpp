@@ -0,0 +1,123 @@
+// Built with -DXORGCAL_FAKE_SCREEN: get_touch_points_parallel() on scripted
+// XI2 contacts, see screen_fake.h. Concurrent touch ids, a contact lifted or
+// slipped off its target while others are held, touch id reuse.
+
+#include "calibration.h"
+#include "screen_x11.h"
+#include "target_placement.h"
+#include "transform_matrix.h"
+#include "log.h"
+
+#include <array>
+#include <cstdio>
+#include <vector>
+
+constexpr size_t target_count = 9;
+
+struct accepted_t
+{
+	std::vector<int> order;
+};
+
+void sample_record(int idx, int, int, void* user)
+{
+	static_cast<accepted_t*>(user)->order.push_back(idx);
+}
+
+// Contacts relative to the targets, touch coordinates are screen coordinates
+// (identity provisional matrix).
+struct script_t
+{
+	std::array<xy_t, target_count> target;
+	std::vector<contact_t> contacts;
+
+	void add(contact_phase_t phase, int touch_id, size_t idx, double dx = 0, double dy = 0)
+	{
+		contacts.push_back(contact_t{phase, touch_id, touch_xy_t{target[idx].x + dx, target[idx].y + dy}});
+	}
+};
+
+// Runs the script on a fresh screen with every target to touch.
+bool script_run(const script_t& script, std::array<touch_point_t, target_count>& touch_point_list,
+	accepted_t& accepted)
+{
+	screen_fake_config_t& panel = screen_x11_t::config();
+	panel.script = script.contacts.data();
+	panel.script_count = script.contacts.size();
+	// not dereferenced by the fake screen
+	static char display_dummy;
+	screen_x11_t scr(reinterpret_cast<Display*>(&display_dummy), 0);
+	for (size_t idx = 0; idx < target_count; ++idx)
+		touch_point_list[idx] = touch_point_t{script.target[idx], touch_xy_t{-1, -1}};
+	xorgcal_callbacks_t callbacks;
+	xorgcal_callbacks_init(&callbacks);
+	callbacks.sample_accepted = sample_record;
+	accepted.order.clear();
+	bool done = get_touch_points_parallel(scr, touch_point_list.data(), 0, target_count,
+		transform_matrix_identity(), 0, &callbacks, &accepted);
+	panel.script = nullptr;
+	panel.script_count = 0;
+	return done;
+}
+
+bool touch_is(const touch_point_t& touch_point, double x, double y)
+{
+	return touch_point.touch.x == x && touch_point.touch.y == y;
+}
+
+int main()
+{
+	script_t script;
+	const screen_fake_config_t& panel = screen_x11_t::config();
+	ASSERT(target_grid(panel.width, panel.height, 3, script.target.data(), target_count) == target_count);
+	// targets 420 px apart, a touch matches within 210 px
+	std::array<touch_point_t, target_count> touch_point_list;
+	accepted_t accepted;
+
+	// two touches held at once, the second one lifted first
+	script.add(CONTACT_BEGIN, 1, 4, 5, -3);
+	script.add(CONTACT_BEGIN, 2, 0, -2, 1);
+	script.add(CONTACT_BEGIN, 1, 4, 50, 50);    // repeated begin of a held touch: ignored
+	script.add(CONTACT_UPDATE, 1, 4, 30, 20);   // small move stays on the target
+	script.add(CONTACT_END, 2, 0, 40, 40);
+	// touch 3 slips off target 8 while touch 1 is held: target 8 is free again
+	script.add(CONTACT_BEGIN, 3, 8);
+	script.add(CONTACT_UPDATE, 3, 8, -300, 0);
+	script.add(CONTACT_END, 3, 8, -300, 0);
+	script.add(CONTACT_END, 1, 4, 30, 20);
+	// touch id 2 reused for another target, touch between targets matches none
+	script.add(CONTACT_BEGIN, 2, 8, 7, 7);
+	script.add(CONTACT_BEGIN, 4, 1, 373, 0);
+	script.add(CONTACT_END, 4, 1, 373, 0);
+	script.add(CONTACT_END, 2, 8, 7, 7);
+	// button press is accepted right away, on a free target only
+	script.add(CONTACT_BEGIN, -1, 1, 1, 1);
+	script.add(CONTACT_BEGIN, -1, 1, 2, 2);
+	const size_t rest[] = {2, 3, 5, 6, 7};
+	int touch_id = 5;
+	for (size_t idx : rest)
+	{
+		script.add(CONTACT_BEGIN, touch_id, idx);
+		script.add(CONTACT_END, touch_id++, idx);
+	}
+
+	ASSERT(script_run(script, touch_point_list, accepted));
+	// accepted at the begin position
+	ASSERT(touch_is(touch_point_list[0], script.target[0].x - 2, script.target[0].y + 1));
+	ASSERT(touch_is(touch_point_list[4], script.target[4].x + 5, script.target[4].y - 3));
+	ASSERT(touch_is(touch_point_list[8], script.target[8].x + 7, script.target[8].y + 7));
+	ASSERT(touch_is(touch_point_list[1], script.target[1].x + 1, script.target[1].y + 1));
+	for (size_t idx : rest)
+		ASSERT(touch_is(touch_point_list[idx], script.target[idx].x, script.target[idx].y));
+	const std::vector<int> order{0, 4, 8, 1, 2, 3, 5, 6, 7};
+	ASSERT(accepted.order == order);
+
+	// script over with targets left: the session is aborted
+	script.contacts.resize(9);
+	ASSERT(!script_run(script, touch_point_list, accepted));
+	ASSERT((accepted.order == std::vector<int>{0, 4}));
+	ASSERT(touch_is(touch_point_list[8], -1, -1));
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,222 @@
+#include "point_transform.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+struct residual_acc_t
+{
+	double sum;
+	double sum_sq;
+	float max;
+};
+
+template <bool affine>
+static void residuals_scalar(const transform_matrix_t& m,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t begin, size_t end, residual_acc_t& acc)
+{
+	for (size_t idx = begin; idx < end; ++idx)
+	{
+		float tx = touch_x[idx];
+		float ty = touch_y[idx];
+		float x = m[0] * tx + m[1] * ty + m[2];
+		float y = m[3] * tx + m[4] * ty + m[5];
+		if (!affine)
+		{
+			float w = m[6] * tx + m[7] * ty + m[8];
+			x /= w;
+			y /= w;
+		}
+		float dx = x - point_x[idx];
+		float dy = y - point_y[idx];
+		float d2 = dx * dx + dy * dy;
+		float d = std::sqrt(d2);
+		acc.sum += d;
+		acc.sum_sq += d2;
+		acc.max = std::max(acc.max, d);
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+
+template <bool affine>
+__attribute__((target("sse2")))
+static size_t residuals_sse2(const transform_matrix_t& m,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count, residual_acc_t& acc)
+{
+	const __m128 a00 = _mm_set1_ps(m[0]), a01 = _mm_set1_ps(m[1]), a02 = _mm_set1_ps(m[2]);
+	const __m128 a10 = _mm_set1_ps(m[3]), a11 = _mm_set1_ps(m[4]), a12 = _mm_set1_ps(m[5]);
+	const __m128 a20 = _mm_set1_ps(m[6]), a21 = _mm_set1_ps(m[7]), a22 = _mm_set1_ps(m[8]);
+	__m128d sum = _mm_setzero_pd();
+	__m128d sum_sq = _mm_setzero_pd();
+	__m128 max = _mm_setzero_ps();
+	size_t idx = 0;
+	for (; idx + 4 <= count; idx += 4)
+	{
+		__m128 tx = _mm_loadu_ps(touch_x + idx);
+		__m128 ty = _mm_loadu_ps(touch_y + idx);
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a00, tx), _mm_mul_ps(a01, ty)), a02);
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a10, tx), _mm_mul_ps(a11, ty)), a12);
+		if (!affine)
+		{
+			__m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a20, tx), _mm_mul_ps(a21, ty)), a22);
+			x = _mm_div_ps(x, w);
+			y = _mm_div_ps(y, w);
+		}
+		__m128 dx = _mm_sub_ps(x, _mm_loadu_ps(point_x + idx));
+		__m128 dy = _mm_sub_ps(y, _mm_loadu_ps(point_y + idx));
+		__m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		__m128 d = _mm_sqrt_ps(d2);
+		max = _mm_max_ps(max, d);
+		sum = _mm_add_pd(sum, _mm_add_pd(_mm_cvtps_pd(d), _mm_cvtps_pd(_mm_movehl_ps(d, d))));
+		sum_sq = _mm_add_pd(sum_sq, _mm_add_pd(_mm_cvtps_pd(d2), _mm_cvtps_pd(_mm_movehl_ps(d2, d2))));
+	}
+	double sum_buf[2];
+	double sum_sq_buf[2];
+	float max_buf[4];
+	_mm_storeu_pd(sum_buf, sum);
+	_mm_storeu_pd(sum_sq_buf, sum_sq);
+	_mm_storeu_ps(max_buf, max);
+	acc.sum += sum_buf[0] + sum_buf[1];
+	acc.sum_sq += sum_sq_buf[0] + sum_sq_buf[1];
+	for (float val : max_buf)
+		acc.max = std::max(acc.max, val);
+	return idx;
+}
+
+template <bool affine>
+__attribute__((target("avx2,fma")))
+static size_t residuals_avx2(const transform_matrix_t& m,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count, residual_acc_t& acc)
+{
+	const __m256 a00 = _mm256_set1_ps(m[0]), a01 = _mm256_set1_ps(m[1]), a02 = _mm256_set1_ps(m[2]);
+	const __m256 a10 = _mm256_set1_ps(m[3]), a11 = _mm256_set1_ps(m[4]), a12 = _mm256_set1_ps(m[5]);
+	const __m256 a20 = _mm256_set1_ps(m[6]), a21 = _mm256_set1_ps(m[7]), a22 = _mm256_set1_ps(m[8]);
+	__m256d sum = _mm256_setzero_pd();
+	__m256d sum_sq = _mm256_setzero_pd();
+	__m256 max = _mm256_setzero_ps();
+	size_t idx = 0;
+	for (; idx + 8 <= count; idx += 8)
+	{
+		__m256 tx = _mm256_loadu_ps(touch_x + idx);
+		__m256 ty = _mm256_loadu_ps(touch_y + idx);
+		__m256 x = _mm256_fmadd_ps(a00, tx, _mm256_fmadd_ps(a01, ty, a02));
+		__m256 y = _mm256_fmadd_ps(a10, tx, _mm256_fmadd_ps(a11, ty, a12));
+		if (!affine)
+		{
+			__m256 w = _mm256_fmadd_ps(a20, tx, _mm256_fmadd_ps(a21, ty, a22));
+			x = _mm256_div_ps(x, w);
+			y = _mm256_div_ps(y, w);
+		}
+		__m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(point_x + idx));
+		__m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(point_y + idx));
+		__m256 d2 = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+		__m256 d = _mm256_sqrt_ps(d2);
+		max = _mm256_max_ps(max, d);
+		sum = _mm256_add_pd(sum, _mm256_add_pd(
+			_mm256_cvtps_pd(_mm256_castps256_ps128(d)),
+			_mm256_cvtps_pd(_mm256_extractf128_ps(d, 1))));
+		sum_sq = _mm256_add_pd(sum_sq, _mm256_add_pd(
+			_mm256_cvtps_pd(_mm256_castps256_ps128(d2)),
+			_mm256_cvtps_pd(_mm256_extractf128_ps(d2, 1))));
+	}
+	double sum_buf[4];
+	double sum_sq_buf[4];
+	float max_buf[8];
+	_mm256_storeu_pd(sum_buf, sum);
+	_mm256_storeu_pd(sum_sq_buf, sum_sq);
+	_mm256_storeu_ps(max_buf, max);
+	acc.sum += sum_buf[0] + sum_buf[1] + sum_buf[2] + sum_buf[3];
+	acc.sum_sq += sum_sq_buf[0] + sum_sq_buf[1] + sum_sq_buf[2] + sum_sq_buf[3];
+	for (float val : max_buf)
+		acc.max = std::max(acc.max, val);
+	return idx;
+}
+
+#endif  // HAVE_X86_SIMD
+
+simd_level_t simd_level_get()
+{
+#ifdef HAVE_X86_SIMD
+	static const simd_level_t level = []()
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return SIMD_AVX2;
+		if (__builtin_cpu_supports("sse2"))
+			return SIMD_SSE2;
+		return SIMD_SCALAR;
+	}();
+	return level;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+const char* simd_level_name(simd_level_t level)
+{
+	switch (level)
+	{
+	case SIMD_SCALAR: return "scalar";
+	case SIMD_SSE2: return "sse2";
+	case SIMD_AVX2: return "avx2";
+	}
+	return "unknown";
+}
+
+template <bool affine>
+static void residuals(simd_level_t level, const transform_matrix_t& matr,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count, residual_acc_t& acc)
+{
+	size_t done = 0;
+#ifdef HAVE_X86_SIMD
+	if (level == SIMD_AVX2)
+		done = residuals_avx2<affine>(matr, touch_x, touch_y, point_x, point_y, count, acc);
+	else if (level == SIMD_SSE2)
+		done = residuals_sse2<affine>(matr, touch_x, touch_y, point_x, point_y, count, acc);
+#endif
+	residuals_scalar<affine>(matr, touch_x, touch_y, point_x, point_y, done, count, acc);
+}
+
+residual_stats_t transform_residuals(simd_level_t level, const transform_matrix_t& matr,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count)
+{
+	residual_acc_t acc{};
+	bool affine = matr[6] == 0 && matr[7] == 0 && matr[8] == 1;
+	if (affine)
+		residuals<true>(level, matr, touch_x, touch_y, point_x, point_y, count, acc);
+	else
+		residuals<false>(level, matr, touch_x, touch_y, point_x, point_y, count, acc);
+
+	residual_stats_t stats{};
+	stats.count = count;
+	if (count == 0)
+		return stats;
+	stats.mean = acc.sum / count;
+	stats.rms = std::sqrt(acc.sum_sq / count);
+	stats.max = acc.max;
+	return stats;
+}
+
+residual_stats_t transform_residuals(const transform_matrix_t& matr,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count)
+{
+	return transform_residuals(simd_level_get(), matr, touch_x, touch_y, point_x, point_y, count);
+}
@@ -0,0 +1,40 @@
+#ifndef POINT_TRANSFORM_H
+#define POINT_TRANSFORM_H
+
+#include "transform_matrix.h"
+
+#include <cstddef>
+
+struct residual_stats_t
+{
+	size_t count;
+	double mean;  // mean distance
+	double rms;
+	double max;
+};
+
+// Applies matr to touch points and measures distance to expected screen points
+// in one pass. Points are in matrix (normalized) coordinates, structure of arrays.
+residual_stats_t transform_residuals(const transform_matrix_t& matr,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count);
+
+enum simd_level_t
+{
+	SIMD_SCALAR = 0,
+	SIMD_SSE2,
+	SIMD_AVX2,
+};
+
+// Best level supported by CPU, transform_residuals() dispatches to it.
+simd_level_t simd_level_get();
+const char* simd_level_name(simd_level_t level);
+
+// Runs given implementation, level shall be supported by CPU.
+residual_stats_t transform_residuals(simd_level_t level, const transform_matrix_t& matr,
+	const float* touch_x, const float* touch_y,
+	const float* point_x, const float* point_y,
+	size_t count);
+
+#endif  // POINT_TRANSFORM_H
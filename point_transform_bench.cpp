@@ -0,0 +1,64 @@
+#include "point_transform.h"
+#include "log.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+bool verbose = false;
+
+// Usage: ./point_transform_bench [number of points]
+int main(int argc, const char* argv[])
+{
+	size_t count = 50 * 1000 * 1000;
+	if (argc > 1)
+		count = strtoul(argv[1], NULL, 10);
+
+	// screen points with touches distorted by known matrix plus noise
+	transform_matrix_t matr{
+		1.02f, 0.01f, -0.01f,
+		-0.02f, 0.98f, 0.015f,
+		0, 0, 1};
+	transform_matrix_t distortion{};
+	ASSERT(transform_matrix_inverse(matr, distortion));
+	std::vector<float> touch_x(count);
+	std::vector<float> touch_y(count);
+	std::vector<float> point_x(count);
+	std::vector<float> point_y(count);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> uniform(0, 1);
+	std::normal_distribution<float> noise(0, 0.001f);
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		float x = uniform(rng);
+		float y = uniform(rng);
+		point_x[idx] = x;
+		point_y[idx] = y;
+		touch_x[idx] = distortion[0] * x + distortion[1] * y + distortion[2] + noise(rng);
+		touch_y[idx] = distortion[3] * x + distortion[4] * y + distortion[5] + noise(rng);
+	}
+
+	printf("points: %zu, dispatch: %s\n", count, simd_level_name(simd_level_get()));
+	residual_stats_t reference{};
+	for (int level = SIMD_SCALAR; level <= simd_level_get(); ++level)
+	{
+		constexpr int repeat = 5;
+		residual_stats_t stats{};
+		auto start = std::chrono::steady_clock::now();
+		for (int idx = 0; idx < repeat; ++idx)
+			stats = transform_residuals(static_cast<simd_level_t>(level), matr,
+				touch_x.data(), touch_y.data(), point_x.data(), point_y.data(), count);
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+		printf("%-7s %8.1f Mpoints/s  mean: %.6g rms: %.6g max: %.6g\n",
+			simd_level_name(static_cast<simd_level_t>(level)),
+			count / sec / 1e6, stats.mean, stats.rms, stats.max);
+		if (level == SIMD_SCALAR)
+			reference = stats;
+		ASSERT(std::fabs(stats.rms - reference.rms) <= 1e-4 * reference.rms);
+		ASSERT(std::fabs(stats.max - reference.max) <= 1e-4 * reference.max);
+	}
+	return 0;
+}
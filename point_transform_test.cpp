@@ -0,0 +1,66 @@
+#include "point_transform.h"
+#include "log.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+bool verbose = false;
+
+bool near(double a, double b)
+{
+	return std::fabs(a - b) <= 1e-5 * std::max(1., std::fabs(b));
+}
+
+// Every SIMD level against scalar, lengths that leave tails for SSE2 (4) and AVX2 (8) loops.
+void levels_test(const transform_matrix_t& matr)
+{
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> uniform(0, 1);
+	for (size_t count : {0, 1, 3, 4, 7, 8, 9, 17, 31})
+	{
+		std::vector<float> touch_x(count);
+		std::vector<float> touch_y(count);
+		std::vector<float> point_x(count);
+		std::vector<float> point_y(count);
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			touch_x[idx] = uniform(rng);
+			touch_y[idx] = uniform(rng);
+			point_x[idx] = uniform(rng);
+			point_y[idx] = uniform(rng);
+		}
+		// largest error in the last element: lost if the tail is skipped
+		if (count > 0)
+			point_x[count - 1] = 5;
+		residual_stats_t reference = transform_residuals(SIMD_SCALAR, matr,
+			touch_x.data(), touch_y.data(), point_x.data(), point_y.data(), count);
+		ASSERT(reference.count == count);
+		for (int level = SIMD_SSE2; level <= simd_level_get(); ++level)
+		{
+			residual_stats_t stats = transform_residuals(static_cast<simd_level_t>(level), matr,
+				touch_x.data(), touch_y.data(), point_x.data(), point_y.data(), count);
+			ASSERT(stats.count == count);
+			ASSERT(near(stats.mean, reference.mean));
+			ASSERT(near(stats.rms, reference.rms));
+			ASSERT(near(stats.max, reference.max));
+		}
+	}
+}
+
+int main()
+{
+	printf("dispatch: %s\n", simd_level_name(simd_level_get()));
+	levels_test(transform_matrix_t{1.02f, 0.01f, -0.01f, -0.02f, 0.98f, 0.015f, 0, 0, 1});
+	// projective matrix takes the division path
+	levels_test(transform_matrix_t{1.02f, 0.01f, -0.01f, -0.02f, 0.98f, 0.015f, 0.01f, -0.02f, 1});
+
+	// exact mapping has no residual
+	float touch[3] = {0.1f, 0.5f, 0.9f};
+	residual_stats_t exact = transform_residuals(transform_matrix_identity(), touch, touch, touch, touch, 3);
+	ASSERT(exact.max == 0 && exact.rms == 0);
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef RLS_H
+#define RLS_H
+
+// Recursive least squares estimator of y = theta^T x
+// for N inputs and M outputs sharing one covariance matrix.
+// Every update is O(N^2 + N*M), no allocations.
+
+#include "matrix.h"
+
+template <size_t N, size_t M, typename T>
+struct rls_t
+{
+	// p0 - initial covariance: small value - trust the seed, large - learn fast.
+	// lambda - forgetting factor, 1 - never forget, 0.99..0.999 - track drift.
+	// trace_max - bound of trace(P), 0 - none. With lambda < 1 directions not excited
+	// by the inputs (e.g. all x in a small cluster) grow P without limit otherwise
+	// and a single sample then moves theta arbitrarily far.
+	rls_t(const mat<N, M, T>& theta_seed, T p0, T lambda_, T trace_max_ = 0)
+	: theta(theta_seed)
+	, p(mat<N, N, T>::identity())
+	, lambda(lambda_)
+	, trace_max(trace_max_)
+	, count(0)
+	{
+		for (size_t idx = 0; idx < N; ++idx)
+			p.m[idx][idx] = p0;
+	}
+
+	void update(const vec<N, T>& x, const vec<M, T>& y)
+	{
+		vec<N, T> px = p * x;
+		T denom = lambda + dot(x, px);
+		vec<N, T> k = px / denom;
+		for (size_t out = 0; out < M; ++out)
+		{
+			T err = y[out];
+			for (size_t idx = 0; idx < N; ++idx)
+				err -= theta.m[idx][out] * x[idx];
+			for (size_t idx = 0; idx < N; ++idx)
+				theta.m[idx][out] += k[idx] * err;
+		}
+		// P = (P - k (P x)^T) / lambda, P stays symmetric
+		for (size_t row = 0; row < N; ++row)
+			for (size_t col = 0; col < N; ++col)
+				p.m[row][col] = (p.m[row][col] - k[row] * px[col]) / lambda;
+		T trace = p_trace();
+		if (trace_max > 0 && trace > trace_max)
+			for (auto& row : p.m)
+				for (auto& val : row)
+					val *= trace_max / trace;
+		++count;
+	}
+
+	vec<M, T> predict(const vec<N, T>& x) const
+	{
+		return transpose(theta) * x;
+	}
+
+	T p_trace() const
+	{
+		T trace = 0;
+		for (size_t idx = 0; idx < N; ++idx)
+			trace += p.m[idx][idx];
+		return trace;
+	}
+
+	mat<N, M, T> theta;
+	mat<N, N, T> p;
+	T lambda;
+	T trace_max;
+	size_t count;
+};
+
+#endif  // RLS_H
@@ -0,0 +1,138 @@
+#ifndef SCREEN_FAKE_H
+#define SCREEN_FAKE_H
+
+// Headless screen_x11_t (-DXORGCAL_FAKE_SCREEN): a whole session runs without
+// an X server, e.g. alloc_test. No window, nothing is drawn, nothing allocated.
+// Each target drawn red is touched once, first drawn first touched, at
+// point * panel_scale + panel_offset - what an uncalibrated panel reports.
+// With no target left a key press is returned, so the session aborts instead of waiting.
+// With a contact script the contacts are returned as they are, in order, instead.
+// Included by screen_x11.h in place of the X11 screen.
+
+#include <cstring>
+
+// Shared by all fake screens, set before the session is created.
+struct screen_fake_config_t
+{
+	int width;
+	int height;
+	bool touch;               // touch_select() result
+	touch_xy_t panel_scale;
+	touch_xy_t panel_offset;
+	const contact_t* script;  // replaces touches of the targets, nullptr - none
+	size_t script_count;
+};
+
+constexpr unsigned int screen_fake_abort_keycode = 9;   // Escape
+
+struct screen_x11_t
+{
+	// display is not used, nullptr fails as with X11
+	screen_x11_t(Display* display, int screen_num)
+	: is_valid(display != nullptr)
+	, display_(display)
+	, screen_num_(screen_num)
+	, width_(config().width)
+	, height_(config().height)
+	, pending_()
+	, pending_count_(0)
+	, script_pos_(0)
+	{
+		if (display_ == nullptr)
+			ERR("failed: no display");
+	}
+
+	static screen_fake_config_t& config()
+	{
+		static screen_fake_config_t config{1920, 1080, true, {1, 1}, {0, 0}, nullptr, 0};
+		return config;
+	}
+
+	void clear()
+	{
+		pending_count_ = 0;
+	}
+
+	void rect(rect_t, color_index_t) {}
+	void circle(xy_t, coordinate_t, color_index_t) {}
+	void cross(xy_t, coordinate_t, color_index_t) {}
+	void disc(xy_t, coordinate_t, color_index_t) {}
+	void text(xy_t, const char*) {}
+	int text_width(const char* text) { return 8 * strlen(text); }
+	int text_height() { return 16; }
+
+	// Red target waits for its touch, any other color is done with or dimmed.
+	void target(xy_t center, coordinate_t, color_index_t color_idx)
+	{
+		xy_t* end = pending_.data() + pending_count_;
+		xy_t* found = std::find_if(pending_.data(), end,
+			[center](const xy_t& xy){ return xy.x == center.x && xy.y == center.y; });
+		if (color_idx == RED && found == end && pending_count_ < pending_.size())
+			pending_[pending_count_++] = center;
+		else if (color_idx != RED && found != end)
+		{
+			std::copy(found + 1, end, found);
+			--pending_count_;
+		}
+	}
+
+	bool get_touch_button_event(touch_xy_t& xy, unsigned int& keycode)
+	{
+		xy.x = -1;
+		xy.y = -1;
+		contact_t contact{};
+		while (get_contact_event(contact, keycode))
+			if (contact.phase == CONTACT_BEGIN)
+			{
+				xy = contact.xy;
+				return true;
+			}
+		return false;
+	}
+
+	// Next scripted contact, else button press on the oldest red target, abort key with none.
+	bool get_contact_event(contact_t& contact, unsigned int& keycode)
+	{
+		keycode = 0;
+		const screen_fake_config_t& panel = config();
+		if (panel.script != nullptr && script_pos_ < panel.script_count)
+		{
+			contact = panel.script[script_pos_++];
+			return true;
+		}
+		if (panel.script != nullptr || pending_count_ == 0)
+		{
+			keycode = screen_fake_abort_keycode;
+			return false;
+		}
+		xy_t point = pending_[0];
+		std::copy(pending_.begin() + 1, pending_.begin() + pending_count_, pending_.begin());
+		--pending_count_;
+		contact = contact_t{CONTACT_BEGIN, -1, touch_xy_t{
+			point.x * panel.panel_scale.x + panel.panel_offset.x,
+			point.y * panel.panel_scale.y + panel.panel_offset.y}};
+		return true;
+	}
+
+	bool touch_select()
+	{
+		return config().touch;
+	}
+
+	void ring_start(xy_t, coordinate_t) {}
+	void ring_stop() {}
+	void press_start(xy_t, coordinate_t) {}
+	void press_stop(xy_t) {}
+	void wait(int, int) {}
+
+	bool is_valid;
+	Display* display_;
+	int screen_num_;
+	int width_;
+	int height_;
+	std::array<xy_t, max_touch_points> pending_;   // red targets, oldest first
+	size_t pending_count_;
+	size_t script_pos_;
+};
+
+#endif  // SCREEN_FAKE_H
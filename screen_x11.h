@@ -6,6 +6,7 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XInput2.h>
 
 #ifdef HAVE_XFT
 #include <X11/Xft/Xft.h>
@@ -15,8 +16,18 @@
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#ifdef HAVE_X11_PRESENT
+#include <X11/extensions/Xpresent.h>
+#endif
+
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+#include <sys/select.h>
 
 enum color_index_t
 {
@@ -29,8 +40,10 @@ enum color_index_t
 	COLOR_INDEX_END
 };
 
-// X11 color names. See XParseColor()
-std::array<const char*, COLOR_INDEX_END> color_name_list{"BLACK", "WHITE", "GRAY", "DIMGRAY", "RED", "BLUE"};
+// X11 color specs. See XParseColor()
+// Numeric "#rrggbb" specs are parsed by Xlib without a server round trip,
+// color names would need XLookupColor() request for each.
+static const std::array<const char*, COLOR_INDEX_END> color_name_list{"#000000", "#ffffff", "#bebebe", "#696969", "#ff0000", "#0000ff"};
 
 struct rect_t
 {
@@ -46,13 +59,46 @@ struct color_t
 {
 };
 
+enum contact_phase_t
+{
+	CONTACT_BEGIN,
+	CONTACT_UPDATE,
+	CONTACT_END
+};
+
+// Touch from XI2 touch events, touch_id tells concurrent touches apart.
+// ButtonPress is a contact with touch_id -1 and only CONTACT_BEGIN.
+struct contact_t
+{
+	contact_phase_t phase;
+	int touch_id;
+	touch_xy_t xy;
+};
+
 constexpr int invalid_screen_num = -1;
+constexpr int frame_interval_ms = 33;   // animation frame rate cap, ~30 fps
+constexpr int ring_period_ms = 1000;    // target ring shrink cycle
+constexpr int ring_line_width = 2;
+constexpr int press_fill_ms = 600;      // press arc closes to a circle while the touch is held
+constexpr size_t max_press_arcs = 10;
+
+#ifdef XORGCAL_FAKE_SCREEN
+#include "screen_fake.h"
+#else
 
 struct screen_x11_t
 {
 	screen_x11_t(int screen_num = invalid_screen_num)
+	: screen_x11_t(XOpenDisplay(NULL), screen_num)
+	{
+		own_display_ = true;
+	}
+
+	// Uses connection owned by the caller, e.g. library user.
+	screen_x11_t(Display* display, int screen_num)
     : is_valid(false)
-    , display_(nullptr)
+    , own_display_(false)
+    , display_(display)
     , screen_num_(screen_num)
     , win_()
     , gc_()
@@ -66,10 +112,27 @@ struct screen_x11_t
 	, xrcolor_()
 	, xftcolor_()
 #endif  // HAVE_XFT
+	, ring_gc_()
+	, ring_active_(false)
+	, ring_drawn_(false)
+	, ring_center_()
+	, ring_radius_max_(0)
+	, ring_radius_(0)
+	, ring_start_()
+	, frame_deadline_()
+	, present_opcode_(-1)
+	, present_serial_(0)
+	, present_msc_(0)
+	, present_msc_valid_(false)
+	, press_()
+	, press_count_(0)
+	, xi_opcode_(-1)
 	{
-		display_ = XOpenDisplay(NULL);
 		if (display_ == nullptr)
+		{
 			ERR("failed: XOpenDisplay(): Unable to connect to X server");
+			return;
+		}
 		LOG("screen_num: %d", screen_num_);
 		if (screen_num_ == invalid_screen_num)
 			screen_num_ = DefaultScreen(display_);
@@ -90,17 +153,11 @@ struct screen_x11_t
 		XGrabPointer(display_, win_,
 			False, ButtonPressMask, GrabModeAsync, GrabModeAsync, None, None, CurrentTime);
 
-		Colormap colormap = DefaultColormap(display_, screen_num_);
-		XColor color;
-		for (size_t idx = 0; idx < COLOR_INDEX_END; ++idx)
-		{
-			XParseColor(display_, colormap, color_name_list[idx], &color);
-			XAllocColor(display_, colormap, &color);
-			pixel_[idx] = color.pixel;
-		}
+		colors_init();
 		XSetWindowBackground(display_, win_, pixel_[GRAY]);
 		XClearWindow(display_, win_);
 		gc_ = XCreateGC(display_, win_, 0, NULL);
+		frame_init();
 
 		text_init();  // TODO check return
 		is_valid = true;
@@ -108,17 +165,72 @@ struct screen_x11_t
 
 	~screen_x11_t()
 	{
-		// TODO check if varibles valid
+		if (!is_valid)
+		{
+			if (own_display_ && display_ != nullptr)
+				XCloseDisplay(display_);
+			return;
+		}
 		text_uninit();
 		XUngrabPointer(display_, CurrentTime);
 		XUngrabKeyboard(display_, CurrentTime);
 		XFreeGC(display_, gc_);
-		XCloseDisplay(display_);
+		XFreeGC(display_, ring_gc_);
+		XDestroyWindow(display_, win_);
+		if (own_display_)
+			XCloseDisplay(display_);
+		else
+			XSync(display_, False);
+	}
+
+	// TrueColor pixel values are computed from the visual masks locally,
+	// other visuals need XAllocColor() round trip for each color.
+	void colors_init()
+	{
+		Visual* visual = DefaultVisual(display_, screen_num_);
+		Colormap colormap = DefaultColormap(display_, screen_num_);
+		XColor color;
+		for (size_t idx = 0; idx < COLOR_INDEX_END; ++idx)
+		{
+			XParseColor(display_, colormap, color_name_list[idx], &color);
+			if (visual->c_class == TrueColor)
+			{
+				pixel_[idx] =
+					color_channel(color.red, visual->red_mask) |
+					color_channel(color.green, visual->green_mask) |
+					color_channel(color.blue, visual->blue_mask);
+				continue;
+			}
+			XAllocColor(display_, colormap, &color);
+			pixel_[idx] = color.pixel;
+		}
+	}
+
+	static unsigned long color_channel(unsigned short value, unsigned long mask)
+	{
+		if (mask == 0)
+			return 0;
+		int shift = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			++shift;
+		}
+		return ((value * mask + 0x7fff) / 0xffff) << shift;
 	}
 
 #ifdef HAVE_XFT
+	// Xft keeps per display info in a global list without locking,
+	// screens of different displays can be used from different threads.
+	static std::mutex& xft_mutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
 	bool text_init()
 	{
+		std::lock_guard<std::mutex> lock(xft_mutex());
 		font_ = XftFontOpenName(display_, DefaultScreen(display_), "Arial-16");
 		assert(font_);
 		xftdraw_ = XftDrawCreate(display_, win_,
@@ -139,6 +251,7 @@ struct screen_x11_t
 
 	void text_uninit()
 	{
+		std::lock_guard<std::mutex> lock(xft_mutex());
 		XftColorFree(display_,
 			DefaultVisual(display_, DefaultScreen(display_)),
 			DefaultColormap(display_, DefaultScreen(display_)), &xftcolor_);
@@ -148,7 +261,7 @@ struct screen_x11_t
 
 	void text(xy_t xy, const char* text)
 	{
-
+		std::lock_guard<std::mutex> lock(xft_mutex());
 		XSetForeground(display_, gc_, pixel_[BLACK]);
 		XSetLineAttributes(display_, gc_, 1, LineSolid, CapRound, JoinRound);
 
@@ -161,6 +274,7 @@ struct screen_x11_t
 
 	XGlyphInfo text_extents(const char* text, size_t text_len)
 	{
+		std::lock_guard<std::mutex> lock(xft_mutex());
 		XGlyphInfo extents;
 		XftTextExtentsUtf8(display_, font_,
 			reinterpret_cast<const FcChar8*>(text), text_len, &extents);
@@ -191,6 +305,15 @@ struct screen_x11_t
 		height_ = DisplayHeight(display_, screen_num_);
 	}
 
+	void clear()
+	{
+		ring_active_ = false;
+		ring_drawn_ = false;
+		press_count_ = 0;
+		XClearWindow(display_, win_);
+		XSync(display_, false);
+	}
+
 	void rect(rect_t rect, color_index_t color_idx)
 	{
 		XSetForeground(display_, gc_, pixel_[color_idx]);
@@ -232,34 +355,404 @@ struct screen_x11_t
 		XSync(display_, false);
 	}
 
-	bool get_touch_button_event(xy_t& xy, unsigned int& keycode)
+	// Target mark: cross of size with a circle in the center.
+	void target(xy_t center, coordinate_t size, color_index_t color_idx)
+	{
+		cross(center, size, color_idx);
+		circle(center, size / 5, color_idx);
+	}
+
+	void disc(xy_t center, coordinate_t radius, color_index_t color_idx)
+	{
+		XSetForeground(display_, gc_, pixel_[color_idx]);
+		XFillArc(display_, win_, gc_,
+			center.x - radius, center.y - radius,
+			2 * radius, 2 * radius,
+			0, 360 * 64);
+
+		XSync(display_, false);
+	}
+
+	// Handles all queued events, returns true on touch (ButtonPress),
+	// keycode is set on KeyPress. Frame events are consumed here.
+	bool get_touch_button_event(touch_xy_t& xy, unsigned int& keycode)
 	{
 		xy.x = -1;
 		xy.y = -1;
+		contact_t contact{};
+		while (get_contact_event(contact, keycode))
+			if (contact.phase == CONTACT_BEGIN)
+			{
+				xy = contact.xy;
+				return true;
+			}
+		return false;
+	}
+
+	// Handles queued events until a contact: ButtonPress or, after touch_select(),
+	// XI2 touch event. keycode is set on KeyPress. Frame events are consumed here.
+	bool get_contact_event(contact_t& contact, unsigned int& keycode)
+	{
 		keycode = 0;
 
-		XEvent event;
-		if (!XCheckWindowEvent(display_, win_, -1, &event))
-			return false;
+		while (XPending(display_) > 0)
+		{
+			XEvent event;
+			XNextEvent(display_, &event);
+			if (event.type == GenericEvent)
+			{
+				if (event.xcookie.extension == xi_opcode_)
+				{
+					if (touch_event(event, contact))
+						return true;
+					continue;
+				}
+				frame_event(event);
+				continue;
+			}
+			if (event.xany.window != win_)
+				continue;
+			if (event.type == Expose)
+			{
+				expose(event.xexpose);
+				continue;
+			}
+
+			if (event.type == KeyPress)
+			{
+				LOG("KeyPress: keycode: %x", event.xkey.keycode);
+				keycode = event.xkey.keycode;
+				return false;
+			}
+			// ButtonPress - mouse button or touch
+			if (event.type == ButtonPress)
+			{
+				contact = contact_t{CONTACT_BEGIN, -1, {1. * event.xbutton.x, 1. * event.xbutton.y}};
+				return true;
+			}
+		}
+		return false;
+	}
 
-		// ButtonPress - mouse button or touch
-		if (event.type != KeyPress && event.type != ButtonPress)
+	// Touch events of all devices on the window (XI 2.2) instead of button presses,
+	// so concurrent touches are delivered each with its own touch id.
+	// The pointer grab is released: touches to a grabbing client are emulated
+	// pointer events. False if the server has no XI 2.2, button presses stay.
+	bool touch_select()
+	{
+		int event_base, error_base;
+		if (!XQueryExtension(display_, "XInputExtension", &xi_opcode_, &event_base, &error_base))
+		{
+			xi_opcode_ = -1;
+			ERR("failed: XQueryExtension(): no XInputExtension");
 			return false;
-		
-		if (event.type == KeyPress)
+		}
+		int major = 2;
+		int minor = 2;
+		if (XIQueryVersion(display_, &major, &minor) != Success || major * 100 + minor < 202)
 		{
-			LOG("KeyPress: keycode: %x", event.xkey.keycode);
-			keycode = event.xkey.keycode;
+			xi_opcode_ = -1;
+			ERR("failed: XIQueryVersion(): XI %d.%d, touch events need 2.2", major, minor);
+			return false;
+		}
+		std::array<unsigned char, XIMaskLen(XI_LASTEVENT)> mask_bits{};
+		XISetMask(mask_bits.data(), XI_TouchBegin);
+		XISetMask(mask_bits.data(), XI_TouchUpdate);
+		XISetMask(mask_bits.data(), XI_TouchEnd);
+		XIEventMask mask{XIAllMasterDevices, static_cast<int>(mask_bits.size()), mask_bits.data()};
+		XUngrabPointer(display_, CurrentTime);
+		XISelectEvents(display_, win_, &mask, 1);
+		XSync(display_, False);
+		LOG("XI %d.%d touch events selected", major, minor);
+		return true;
+	}
+
+	bool touch_event(XEvent& event, contact_t& contact)
+	{
+		if (!XGetEventData(display_, &event.xcookie))
 			return false;
+		bool rc = false;
+		const XIDeviceEvent* device_event = static_cast<const XIDeviceEvent*>(event.xcookie.data);
+		if (device_event->event == win_)
+		{
+			rc = true;
+			switch (event.xcookie.evtype)
+			{
+			case XI_TouchBegin: contact.phase = CONTACT_BEGIN; break;
+			case XI_TouchUpdate: contact.phase = CONTACT_UPDATE; break;
+			case XI_TouchEnd: contact.phase = CONTACT_END; break;
+			default: rc = false;
+			}
+			contact.touch_id = device_event->detail;
+			contact.xy = touch_xy_t{device_event->event_x, device_event->event_y};
 		}
+		XFreeEventData(display_, &event.xcookie);
+		return rc;
+	}
 
-		xy.x = event.xbutton.x;
-		xy.y = event.xbutton.y;
+	// Frame scheduler for animated targets. Frames are paced by Present
+	// MSC completion events when the server has Present, by steady clock
+	// timer otherwise, at most one frame per frame_interval_ms.
+	// Nothing is drawn and no timer runs without animation.
+	using frame_clock_t = std::chrono::steady_clock;
 
-		return true;
+	// Arc around a held target, drawn with the ring GC.
+	struct press_arc_t
+	{
+		xy_t center;
+		coordinate_t size;     // target size, arc radius is size / 3
+		frame_clock_t::time_point start;
+		int angle;             // drawn, 1/64 degree, 0 - not drawn
+	};
+
+	void frame_init()
+	{
+		// ring is drawn with xor: drawing it again erases it and restores what was under it,
+		// so a frame touches only the old and the new ring pixels
+		XGCValues values{};
+		values.function = GXxor;
+		values.foreground = pixel_[RED] ^ pixel_[GRAY];
+		values.line_width = ring_line_width;
+		ring_gc_ = XCreateGC(display_, win_, GCFunction | GCForeground | GCLineWidth, &values);
+#ifdef HAVE_X11_PRESENT
+		int event_base, error_base;
+		if (XPresentQueryExtension(display_, &present_opcode_, &event_base, &error_base))
+			XPresentSelectInput(display_, win_, PresentCompleteNotifyMask);
+		else
+			present_opcode_ = -1;
+		LOG("Present: %s", present_opcode_ >= 0 ? "yes" : "no, timer frames");
+#endif  // HAVE_X11_PRESENT
+	}
+
+	// Ring around the active (red) target of size radius shrinking from radius
+	// to radius / 5, repeated.
+	void ring_start(xy_t center, coordinate_t radius)
+	{
+		ring_stop();
+		frame_start();
+		ring_active_ = true;
+		ring_center_ = center;
+		ring_radius_max_ = radius;
+		ring_start_ = frame_clock_t::now();
+	}
+
+	void ring_stop()
+	{
+		if (ring_drawn_)
+		{
+			ring_draw(ring_radius_);
+			XFlush(display_);
+		}
+		ring_drawn_ = false;
+		ring_active_ = false;
+	}
+
+	// Press progress on the held (blue) target of size at center: an arc from
+	// 12 o'clock clockwise, closed after press_fill_ms. Ignored over max_press_arcs.
+	void press_start(xy_t center, coordinate_t size)
+	{
+		if (press_count_ == press_.size())
+			return;
+		frame_start();
+		press_[press_count_++] = press_arc_t{center, size, frame_clock_t::now(), 0};
+	}
+
+	// Erases the arc of the target at center, before the target is redrawn.
+	void press_stop(xy_t center)
+	{
+		press_arc_t* end = press_.data() + press_count_;
+		press_arc_t* press = std::find_if(press_.data(), end,
+			[center](const press_arc_t& arc){ return arc.center.x == center.x && arc.center.y == center.y; });
+		if (press == end)
+			return;
+		if (press->angle != 0)
+		{
+			press_draw(*press, press->angle);
+			XFlush(display_);
+		}
+		*press = press_[--press_count_];
+	}
+
+	// The server cleared the exposed area to the background, ring pixels there are lost
+	// and the next xor would draw them back instead of erasing. The ring area is cleared
+	// whole, the target redrawn and the ring starts over on the next frame.
+	void expose(const XExposeEvent& event)
+	{
+		for (size_t idx = 0; idx < press_count_; ++idx)
+		{
+			press_arc_t& press = press_[idx];
+			coordinate_t extent = press.size / 3 + ring_line_width;
+			if (!exposed(event, press.center, extent))
+				continue;
+			XClearArea(display_, win_, press.center.x - extent, press.center.y - extent,
+				2 * extent, 2 * extent, False);
+			target(press.center, press.size, BLUE);
+			press.angle = 0;
+			frame_deadline_ = frame_clock_t::now();
+		}
+		if (!ring_active_)
+			return;
+		coordinate_t extent = ring_radius_max_ + ring_line_width;
+		if (!exposed(event, ring_center_, extent))
+			return;
+		LOG("expose %d:%d %dx%d, ring redrawn", event.x, event.y, event.width, event.height);
+		XClearArea(display_, win_, ring_center_.x - extent, ring_center_.y - extent,
+			2 * extent, 2 * extent, False);
+		target(ring_center_, ring_radius_max_, RED);
+		ring_drawn_ = false;
+		frame_deadline_ = frame_clock_t::now();
+	}
+
+	static bool exposed(const XExposeEvent& event, xy_t center, coordinate_t extent)
+	{
+		return event.x < center.x + extent && event.x + event.width > center.x - extent &&
+			event.y < center.y + extent && event.y + event.height > center.y - extent;
+	}
+
+	// Sleeps until X event, fd (-1 - none) is readable, frame or timeout_ms (-1 - forever).
+	// Due frame is drawn.
+	void wait(int fd, int timeout_ms)
+	{
+		frame_tick();
+		if (XPending(display_) > 0)
+			return;
+		if (animating())
+		{
+			auto frame_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				frame_deadline_ - frame_clock_t::now()).count();
+			int frame_wait_ms = static_cast<int>(std::max<decltype(frame_ms)>(frame_ms, 0));
+			if (timeout_ms < 0 || frame_wait_ms < timeout_ms)
+				timeout_ms = frame_wait_ms;
+		}
+		int x_fd = ConnectionNumber(display_);
+		fd_set read_fds;
+		FD_ZERO(&read_fds);
+		FD_SET(x_fd, &read_fds);
+		if (fd >= 0)
+			FD_SET(fd, &read_fds);
+		timeval timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+		select(std::max(x_fd, fd) + 1, &read_fds, nullptr, nullptr, timeout_ms < 0 ? nullptr : &timeout);
+		frame_tick();
+	}
+
+	bool animating() const
+	{
+		return ring_active_ || press_count_ > 0;
+	}
+
+	// First frame of an animation right away. Present MSC of an earlier
+	// animation is stale, it is taken anew before frames are scheduled from it.
+	void frame_start()
+	{
+		if (!animating())
+			present_msc_valid_ = false;
+		frame_deadline_ = frame_clock_t::now();
+	}
+
+	void frame_tick()
+	{
+		if (!animating() || frame_clock_t::now() < frame_deadline_)
+			return;
+		frame_draw();
+		frame_schedule();
+	}
+
+	void frame_draw()
+	{
+		auto now = frame_clock_t::now();
+		bool drawn = false;
+		if (ring_active_)
+		{
+			int elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				now - ring_start_).count() % ring_period_ms;
+			coordinate_t radius_min = ring_radius_max_ / 5;
+			coordinate_t radius = ring_radius_max_ - (ring_radius_max_ - radius_min) * elapsed_ms / ring_period_ms;
+			if (!ring_drawn_ || radius != ring_radius_)
+			{
+				if (ring_drawn_)
+					ring_draw(ring_radius_);
+				ring_draw(radius);
+				ring_radius_ = radius;
+				ring_drawn_ = true;
+				drawn = true;
+			}
+		}
+		for (size_t idx = 0; idx < press_count_; ++idx)
+		{
+			press_arc_t& press = press_[idx];
+			auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - press.start).count();
+			int angle = static_cast<int>(std::min<decltype(elapsed_ms)>(
+				std::max<decltype(elapsed_ms)>(elapsed_ms, 1) * 360 * 64 / press_fill_ms, 360 * 64));
+			if (angle == press.angle)
+				continue;
+			// xor: the old arc is erased, the new one drawn
+			if (press.angle != 0)
+				press_draw(press, press.angle);
+			press_draw(press, angle);
+			press.angle = angle;
+			drawn = true;
+		}
+		if (drawn)
+			XFlush(display_);
+	}
+
+	void ring_draw(coordinate_t radius)
+	{
+		XDrawArc(display_, win_, ring_gc_,
+			ring_center_.x - radius, ring_center_.y - radius,
+			2 * radius, 2 * radius,
+			0, 360 * 64);
+	}
+
+	void press_draw(const press_arc_t& press, int angle)
+	{
+		coordinate_t radius = press.size / 3;
+		XDrawArc(display_, win_, ring_gc_,
+			press.center.x - radius, press.center.y - radius,
+			2 * radius, 2 * radius,
+			90 * 64, -angle);
+	}
+
+	void frame_schedule()
+	{
+		auto now = frame_clock_t::now();
+		frame_deadline_ = now + std::chrono::milliseconds(frame_interval_ms);
+#ifdef HAVE_X11_PRESENT
+		if (present_opcode_ < 0)
+			return;
+		// next frame on completion two vblanks later (30 fps at 60 Hz),
+		// the timer is a fallback if completion does not come (e.g. no vblank).
+		// Without a known MSC, target 0 completes on the current one and gives it.
+		XPresentNotifyMSC(display_, win_, ++present_serial_, present_msc_valid_ ? present_msc_ + 2 : 0, 0, 0);
+		XFlush(display_);
+		frame_deadline_ = now + std::chrono::milliseconds(4 * frame_interval_ms);
+#endif  // HAVE_X11_PRESENT
+	}
+
+	void frame_event(XEvent& event)
+	{
+#ifdef HAVE_X11_PRESENT
+		if (present_opcode_ < 0 || event.xcookie.extension != present_opcode_ ||
+			!XGetEventData(display_, &event.xcookie))
+			return;
+		if (event.xcookie.evtype == PresentCompleteNotify)
+		{
+			XPresentCompleteNotifyEvent* complete = static_cast<XPresentCompleteNotifyEvent*>(event.xcookie.data);
+			if (complete->serial_number == present_serial_)
+			{
+				present_msc_ = complete->msc;
+				present_msc_valid_ = true;
+				frame_deadline_ = frame_clock_t::now();
+			}
+		}
+		XFreeEventData(display_, &event.xcookie);
+#else
+		(void)event;
+#endif  // HAVE_X11_PRESENT
 	}
 
 	bool is_valid;
+	bool own_display_;
     Display* display_;
     int screen_num_;
     Window win_;
@@ -276,5 +769,22 @@ struct screen_x11_t
 	XftColor xftcolor_;
 #endif  // HAVE_XFT
 
+	GC ring_gc_;
+	bool ring_active_;
+	bool ring_drawn_;
+	xy_t ring_center_;
+	coordinate_t ring_radius_max_;
+	coordinate_t ring_radius_;
+	frame_clock_t::time_point ring_start_;
+	frame_clock_t::time_point frame_deadline_;
+	int present_opcode_;       // -1 - no Present, timer frames
+	uint32_t present_serial_;
+	uint64_t present_msc_;
+	bool present_msc_valid_;   // present_msc_ is of the running animation
+	std::array<press_arc_t, max_press_arcs> press_;
+	size_t press_count_;
+	int xi_opcode_;            // -1 - touch events not selected
+
 };
+#endif  // XORGCAL_FAKE_SCREEN
 #endif  // SCREEN_X11_H
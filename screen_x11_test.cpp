@@ -1,9 +1,6 @@
 #include "screen_x11.h"
 #include "log.h"
 
-#include <thread>
-#include <chrono>
-
 bool verbose = true;
 
 int main()
@@ -15,9 +12,14 @@ int main()
 	screen.cross({500, 500}, 105, WHITE);
 	screen.text({510, 510}, "Hello world");
 	screen.text({510, 530}, "Привет мир");
-	xy_t xy{-1, -1};
+	screen.ring_start({900, 500}, 100);
+	touch_xy_t xy{-1, -1};
 	unsigned int keycode = 0;
 	while(keycode == 0 && xy.x == -1)
+	{
 		screen.get_touch_button_event(xy, keycode);
+		screen.wait(-1, -1);
+	}
+	screen.ring_stop();
 	return 0;
 }
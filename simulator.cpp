@@ -0,0 +1,449 @@
+// Monte Carlo accuracy simulator for the calibration solvers.
+// Generates random ground truth panel mappings and noisy touches over
+// a parameter sweep, runs the solvers and writes error distributions.
+
+#include "common.h"
+#include "matrix.h"
+#include "target_placement.h"
+#include "transform_matrix.h"
+#include "log.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+bool verbose = false;
+
+enum solver_t
+{
+	SOLVER_4POINT = 0,  // transform_matrix(), 2x2 grid only
+	SOLVER_LSQ = 1,     // transform_matrix_lsq()
+	SOLVER_ADAPTIVE = 2, // target_placement_t over grid x grid candidates
+};
+
+const char* solver_name[] = {"4point", "lsq", "adaptive"};
+
+struct sim_config_t
+{
+	size_t trials = 100000;  // per sweep cell
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	uint64_t seed = 1;
+	int width = 1920;
+	int height = 1080;
+	std::string output_filename;
+	bool json = false;
+	std::vector<double> noise{0.5, 1, 2, 4};       // touch noise sigma, pixels
+	std::vector<double> rotation{0, 2};            // max panel rotation, degrees
+	std::vector<double> scale{0.05};               // max panel scale error, fraction
+	std::vector<double> offset{20};                // max panel offset, pixels
+	std::vector<double> nonlinearity{0, 0.01};     // max cubic radial term, normalized
+	std::vector<int> grid{2, 3, 4, 5};             // grid x grid targets
+	std::vector<int> solver{SOLVER_4POINT, SOLVER_LSQ};
+	double tolerance = 2;      // adaptive: leave-one-out RMS to stop at, pixels
+	size_t max_targets = 13;   // adaptive
+};
+
+struct sim_cell_t
+{
+	double noise;
+	double rotation;
+	double scale;
+	double offset;
+	double nonlinearity;
+	int grid;
+	int solver;
+};
+
+// Log scale error histogram: no per trial storage, percentiles within bin width.
+struct histogram_t
+{
+	static constexpr size_t bins = 1200;
+	static constexpr double min_px = 1e-3;
+	static constexpr double bins_per_decade = 200;
+
+	std::array<uint64_t, bins> count{};
+	uint64_t total = 0;
+	uint64_t failed = 0;
+	uint64_t targets = 0;
+	double sum = 0;
+	double max = 0;
+
+	void add(double val, size_t target_count)
+	{
+		targets += target_count;
+		double pos = val <= min_px ? 0 : std::log10(val / min_px) * bins_per_decade;
+		size_t bin = std::min(bins - 1, static_cast<size_t>(pos));
+		++count[bin];
+		++total;
+		sum += val;
+		max = std::max(max, val);
+	}
+
+	void merge(const histogram_t& other)
+	{
+		for (size_t idx = 0; idx < bins; ++idx)
+			count[idx] += other.count[idx];
+		total += other.total;
+		failed += other.failed;
+		targets += other.targets;
+		sum += other.sum;
+		max = std::max(max, other.max);
+	}
+
+	double percentile(double pct) const
+	{
+		uint64_t rank = static_cast<uint64_t>(std::ceil(pct / 100 * total));
+		uint64_t acc = 0;
+		for (size_t idx = 0; idx < bins; ++idx)
+		{
+			acc += count[idx];
+			if (acc >= rank && acc > 0)
+				return min_px * std::pow(10, (idx + 1) / bins_per_decade);
+		}
+		return max;
+	}
+};
+
+std::vector<std::string> split(const std::string& str, char delimiter)
+{
+	std::vector<std::string> list;
+	size_t start = 0;
+	while (start <= str.size())
+	{
+		size_t end = str.find(delimiter, start);
+		if (end == std::string::npos)
+			end = str.size();
+		list.push_back(str.substr(start, end - start));
+		start = end + 1;
+	}
+	return list;
+}
+
+std::vector<double> parse_list(const std::string& str)
+{
+	std::vector<double> list;
+	for (const auto& item : split(str, ','))
+		list.push_back(strtod(item.c_str(), NULL));
+	return list;
+}
+
+sim_config_t parse_opts(int argc, const char* argv[])
+{
+	sim_config_t config{};
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		std::string opt = argv[idx];
+		size_t eq = opt.find('=');
+		std::string key = opt.substr(0, eq);
+		std::string val = eq == std::string::npos ? "" : opt.substr(eq + 1);
+		if (key == "trials")
+			config.trials = strtoull(val.c_str(), NULL, 10);
+		else if (key == "threads")
+			config.threads = std::max(1ul, strtoul(val.c_str(), NULL, 10));
+		else if (key == "seed")
+			config.seed = strtoull(val.c_str(), NULL, 10);
+		else if (key == "width")
+			config.width = strtol(val.c_str(), NULL, 10);
+		else if (key == "height")
+			config.height = strtol(val.c_str(), NULL, 10);
+		else if (key == "output_filename")
+			config.output_filename = val;
+		else if (key == "format")
+			config.json = val == "json";
+		else if (key == "noise")
+			config.noise = parse_list(val);
+		else if (key == "rotation")
+			config.rotation = parse_list(val);
+		else if (key == "scale")
+			config.scale = parse_list(val);
+		else if (key == "offset")
+			config.offset = parse_list(val);
+		else if (key == "nonlinearity")
+			config.nonlinearity = parse_list(val);
+		else if (key == "grid")
+		{
+			config.grid.clear();
+			for (double grid : parse_list(val))
+				config.grid.push_back(static_cast<int>(grid));
+		}
+		else if (key == "tolerance")
+			config.tolerance = strtod(val.c_str(), NULL);
+		else if (key == "max_targets")
+			config.max_targets = strtoul(val.c_str(), NULL, 10);
+		else if (key == "solver")
+		{
+			config.solver.clear();
+			for (const auto& name : split(val, ','))
+				config.solver.push_back(name == "lsq" ? SOLVER_LSQ :
+					name == "adaptive" ? SOLVER_ADAPTIVE : SOLVER_4POINT);
+		}
+		else if (key == "verbose")
+			verbose = true;
+		else
+			ERR("unknown option: %s", opt.c_str());
+	}
+	return config;
+}
+
+std::vector<sim_cell_t> sweep(const sim_config_t& config)
+{
+	std::vector<sim_cell_t> cells;
+	for (int solver : config.solver)
+		for (int grid : config.grid)
+		{
+			if (grid < 2 || static_cast<size_t>(grid * grid) > max_touch_points)
+				continue;
+			if (solver == SOLVER_4POINT && grid != 2)
+				continue;
+			if (solver == SOLVER_ADAPTIVE && static_cast<size_t>(grid) > target_placement_t::max_grid)
+				continue;
+			for (double noise : config.noise)
+				for (double rotation : config.rotation)
+					for (double scale : config.scale)
+						for (double offset : config.offset)
+							for (double nonlinearity : config.nonlinearity)
+								cells.push_back(sim_cell_t{noise, rotation, scale, offset, nonlinearity, grid, solver});
+		}
+	return cells;
+}
+
+// Ground truth panel: screen (normalized) -> raw touch (normalized).
+struct panel_t
+{
+	mat33<double> affine;
+	double nonlinearity;
+
+	vec2<double> raw(vec2<double> screen) const
+	{
+		vec2<double> xy = apply(affine, screen);
+		double cx = screen[0] - 0.5;
+		double cy = screen[1] - 0.5;
+		double r2 = cx * cx + cy * cy;
+		xy[0] += nonlinearity * cx * r2;
+		xy[1] += nonlinearity * cy * r2;
+		return xy;
+	}
+};
+
+template <typename rng_t>
+panel_t panel_random(const sim_cell_t& cell, int width, int height, rng_t& rng)
+{
+	std::uniform_real_distribution<double> unit(-1, 1);
+	double angle = cell.rotation * M_PI / 180 * unit(rng);
+	double sx = 1 + cell.scale * unit(rng);
+	double sy = 1 + cell.scale * unit(rng);
+	double ox = cell.offset * unit(rng) / width;
+	double oy = cell.offset * unit(rng) / height;
+	double aspect = 1. * width / height;
+	// rotation in pixel space, expressed in normalized coordinates
+	double c = std::cos(angle);
+	double s = std::sin(angle);
+	mat33<double> rotate{{
+		{c, -s / aspect, 0.5 - 0.5 * c + 0.5 * s / aspect},
+		{s * aspect, c, 0.5 - 0.5 * s * aspect - 0.5 * c},
+		{0, 0, 1}}};
+	mat33<double> scale_offset{{
+		{sx, 0, ox + 0.5 - 0.5 * sx},
+		{0, sy, oy + 0.5 - 0.5 * sy},
+		{0, 0, 1}}};
+	return panel_t{scale_offset * rotate, cell.nonlinearity * unit(rng)};
+}
+
+// RMS screen error of the matrix over evaluation grid covering the whole screen, pixels.
+double matrix_error_px(const panel_t& panel, const transform_matrix_t& matr, int width, int height)
+{
+	constexpr int eval_grid = 8;
+	mat33<double> matr_d = to_mat<double>(matr);
+	double sum_sq = 0;
+	for (int row = 0; row < eval_grid; ++row)
+		for (int col = 0; col < eval_grid; ++col)
+		{
+			vec2<double> screen{{(col + 0.5) / eval_grid, (row + 0.5) / eval_grid}};
+			vec2<double> xy = apply(matr_d, panel.raw(screen));
+			double dx = (xy[0] - screen[0]) * width;
+			double dy = (xy[1] - screen[1]) * height;
+			sum_sq += dx * dx + dy * dy;
+		}
+	return std::sqrt(sum_sq / (eval_grid * eval_grid));
+}
+
+// Every thread owns its RNG and histograms, results are merged after join.
+void simulate(const sim_config_t& config, const std::vector<sim_cell_t>& cells,
+	unsigned thread_idx, std::vector<histogram_t>& histograms)
+{
+	std::seed_seq seed{config.seed, static_cast<uint64_t>(thread_idx)};
+	std::mt19937_64 rng(seed);
+	size_t trials = config.trials / config.threads +
+		(thread_idx < config.trials % config.threads ? 1 : 0);
+	int width = config.width;
+	int height = config.height;
+	std::array<touch_point_t, max_touch_points> touch_point_list{};
+	for (size_t cell_idx = 0; cell_idx < cells.size(); ++cell_idx)
+	{
+		const sim_cell_t& cell = cells[cell_idx];
+		histogram_t& histogram = histograms[cell_idx];
+		std::normal_distribution<double> noise(0, cell.noise);
+		std::array<xy_t, max_touch_points> target{};
+		size_t count = target_grid(width, height, cell.grid, target.data(), target.size());
+		for (size_t idx = 0; idx < count; ++idx)
+			touch_point_list[idx].point = target[idx];
+		for (size_t trial = 0; trial < trials; ++trial)
+		{
+			panel_t panel = panel_random(cell, width, height, rng);
+			auto touch_get = [&](xy_t point)
+			{
+				vec2<double> raw = panel.raw(vec2<double>{{1. * point.x / width, 1. * point.y / height}});
+				return touch_xy_t{raw[0] * width + noise(rng), raw[1] * height + noise(rng)};
+			};
+			transform_matrix_t matr{};
+			size_t target_count = count;
+			if (cell.solver == SOLVER_ADAPTIVE)
+			{
+				target_placement_t placement(width, height, cell.grid, config.tolerance, config.max_targets);
+				xy_t point{};
+				bool valid = true;
+				while (valid && placement.next(point))
+					valid = placement.add(touch_get(point));
+				if (!valid)
+				{
+					++histogram.failed;
+					continue;
+				}
+				matr = placement.matrix_;
+				target_count = placement.count_;
+			}
+			else
+			{
+				for (size_t idx = 0; idx < count; ++idx)
+					touch_point_list[idx].touch = touch_get(touch_point_list[idx].point);
+				if (cell.solver == SOLVER_4POINT)
+				{
+					touch_point_list_t corners{};
+					// grid order is UL UR LL LR for 2x2
+					std::copy(touch_point_list.begin(), touch_point_list.begin() + corners.size(), corners.begin());
+					matr = transform_matrix(corners, width, height);
+				}
+				else
+					matr = transform_matrix_lsq(touch_point_list.data(), count, width, height);
+			}
+			if (!transform_matrix_valid(matr))
+			{
+				++histogram.failed;
+				continue;
+			}
+			histogram.add(matrix_error_px(panel, matr, width, height), target_count);
+		}
+	}
+}
+
+std::string report(const sim_config_t& config, const std::vector<sim_cell_t>& cells,
+	const std::vector<histogram_t>& histograms)
+{
+	std::string out;
+	char line[512];
+	if (config.json)
+		out += "[\n";
+	else
+		out += "solver,grid,noise_px,rotation_deg,scale,offset_px,nonlinearity,"
+			"trials,failed,targets_mean,mean_px,p50_px,p95_px,p99_px,max_px\n";
+	for (size_t idx = 0; idx < cells.size(); ++idx)
+	{
+		const sim_cell_t& cell = cells[idx];
+		const histogram_t& hist = histograms[idx];
+		double mean = hist.total ? hist.sum / hist.total : 0;
+		double targets_mean = hist.total ? 1. * hist.targets / hist.total : 0;
+		const char* format = config.json ?
+			"{\"solver\":\"%s\",\"grid\":%d,\"noise_px\":%g,\"rotation_deg\":%g,\"scale\":%g,"
+			"\"offset_px\":%g,\"nonlinearity\":%g,\"trials\":%llu,\"failed\":%llu,\"targets_mean\":%.2f,"
+			"\"mean_px\":%.4f,\"p50_px\":%.4f,\"p95_px\":%.4f,\"p99_px\":%.4f,\"max_px\":%.4f}%s\n" :
+			"%s,%d,%g,%g,%g,%g,%g,%llu,%llu,%.2f,%.4f,%.4f,%.4f,%.4f,%.4f%s\n";
+		snprintf(line, sizeof(line), format,
+			solver_name[cell.solver], cell.grid, cell.noise, cell.rotation, cell.scale,
+			cell.offset, cell.nonlinearity,
+			static_cast<unsigned long long>(hist.total + hist.failed),
+			static_cast<unsigned long long>(hist.failed),
+			targets_mean, mean, hist.percentile(50), hist.percentile(95), hist.percentile(99), hist.max,
+			config.json && idx + 1 < cells.size() ? "," : "");
+		out += line;
+	}
+	if (config.json)
+		out += "]\n";
+	return out;
+}
+
+void usage()
+{
+	printf(
+		"Usage: ./xorg_calibrator_sim [options]\n"
+		"\n"
+		"options:\n"
+		"trials - trials per sweep cell. Default - 100000\n"
+		"threads - worker threads. Default - all cores\n"
+		"seed - random seed\n"
+		"width, height - screen size in pixels\n"
+		"noise - touch noise sigma list, pixels. Example: noise=0.5,1,2\n"
+		"rotation - max panel rotation list, degrees\n"
+		"scale - max panel scale error list, fraction\n"
+		"offset - max panel offset list, pixels\n"
+		"nonlinearity - max cubic radial distortion list\n"
+		"grid - target grid sizes list. Example: grid=2,3\n"
+		"solver - solver list: 4point,lsq,adaptive. adaptive takes grid as candidate grid, up to 5\n"
+		"tolerance - adaptive: leave-one-out RMS error to stop at, pixels. Default - 2\n"
+		"max_targets - adaptive: targets limit. Default - 13\n"
+		"format - csv or json. Default - csv\n"
+		"output_filename - file to write results to. Default - stdout\n"
+		"\n");
+}
+
+int main(int argc, const char* argv[])
+{
+	for (int idx = 1; idx < argc; ++idx)
+		if (strcmp(argv[idx], "help") == 0 || strcmp(argv[idx], "h") == 0)
+		{
+			usage();
+			return EXIT_SUCCESS;
+		}
+	sim_config_t config = parse_opts(argc, argv);
+	std::vector<sim_cell_t> cells = sweep(config);
+	LOG("cells: %zu trials: %zu threads: %u", cells.size(), config.trials, config.threads);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::vector<histogram_t>> thread_histograms(config.threads, std::vector<histogram_t>(cells.size()));
+	std::vector<std::thread> threads;
+	for (unsigned idx = 0; idx < config.threads; ++idx)
+		threads.emplace_back(simulate, std::cref(config), std::cref(cells), idx, std::ref(thread_histograms[idx]));
+	for (auto& thread : threads)
+		thread.join();
+	std::vector<histogram_t> histograms(cells.size());
+	for (const auto& thread_histogram : thread_histograms)
+		for (size_t idx = 0; idx < cells.size(); ++idx)
+			histograms[idx].merge(thread_histogram[idx]);
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fprintf(stderr, "%zu trials in %.2f s (%.0f trials/s)\n",
+		config.trials * cells.size(), sec, config.trials * cells.size() / sec);
+
+	std::string out = report(config, cells, histograms);
+	if (config.output_filename.empty())
+	{
+		printf("%s", out.c_str());
+		return EXIT_SUCCESS;
+	}
+	FILE* fh = fopen(config.output_filename.c_str(), "w");
+	if (fh == nullptr)
+	{
+		ERR("failed: fopen(): %s : %s", config.output_filename.c_str(), strerror(errno));
+		return EXIT_FAILURE;
+	}
+	fwrite(out.c_str(), 1, out.size(), fh);
+	fclose(fh);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include "target_placement.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr size_t target_placement_t::max_grid;
+
+size_t target_grid(int width, int height, size_t grid, xy_t* out, size_t size)
+{
+	int offset_x = width / 9;
+	int offset_y = height / 9;
+	int cols = static_cast<int>(grid);
+	size_t count = 0;
+	for (int row = 0; row < cols; ++row)
+		for (int col = 0; col < cols && count < size; ++col)
+			out[count++] = xy_t{
+				offset_x + (width - 2 * offset_x) * col / (cols - 1),
+				offset_y + (height - 2 * offset_y) * row / (cols - 1)};
+	return count;
+}
+
+static double distance(xy_t a, xy_t b)
+{
+	return std::hypot(a.x - b.x, a.y - b.y);
+}
+
+double target_match_radius(const xy_t* target, size_t count)
+{
+	double min = HUGE_VAL;
+	for (size_t idx = 0; idx < count; ++idx)
+		for (size_t other = idx + 1; other < count; ++other)
+			min = std::min(min, distance(target[idx], target[other]));
+	return min / 2;
+}
+
+size_t target_nearest(const xy_t* target, const bool* taken, size_t count, touch_xy_t xy, double max_distance)
+{
+	size_t nearest = count;
+	double nearest_distance = max_distance;
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		double dist = std::hypot(target[idx].x - xy.x, target[idx].y - xy.y);
+		if (!taken[idx] && dist <= nearest_distance)
+		{
+			nearest = idx;
+			nearest_distance = dist;
+		}
+	}
+	return nearest;
+}
+
+touch_xy_t target_predict(const transform_matrix_t& matr, touch_xy_t touch, int width, int height)
+{
+	vec2<double> xy = apply(to_mat<double>(matr), vec2<double>{{touch.x / width, touch.y / height}});
+	return touch_xy_t{xy[0] * width, xy[1] * height};
+}
+
+target_placement_t::target_placement_t(int width, int height, size_t grid, double tolerance_px, size_t max_targets)
+: width_(width)
+, height_(height)
+, tolerance_px_(tolerance_px)
+, max_targets_(0)
+, grid_(std::min(std::max<size_t>(grid, 2), max_grid))
+, candidate_()
+, used_()
+, candidate_count_(0)
+, next_(0)
+, touch_point_list_()
+, count_(0)
+, solved_(false)
+, done_(false)
+, matrix_(transform_matrix_identity())
+, quality_()
+{
+	candidate_count_ = target_grid(width, height, grid_, candidate_.data(), candidate_.size());
+	max_targets_ = std::min(std::max<size_t>(max_targets, NUM_POINTS), candidate_count_);
+}
+
+bool target_placement_t::next(xy_t& point)
+{
+	if (done_ || count_ >= max_targets_)
+		return false;
+	const size_t corner[] = {0, grid_ - 1, candidate_count_ - grid_, candidate_count_ - 1};
+	if (count_ < NUM_POINTS)
+		next_ = corner[count_];
+	else
+	{
+		// touch expected at the candidate: provisional matrix maps touch to screen
+		transform_matrix_t inv{};
+		if (!transform_matrix_inverse(matrix_, inv))
+			inv = transform_matrix_identity();
+		mat33<double> inv_d = to_mat<double>(inv);
+		next_ = candidate_count_;
+		double best = -1;
+		for (size_t idx = 0; idx < candidate_count_; ++idx)
+		{
+			if (used_[idx])
+				continue;
+			vec2<double> touch = apply(inv_d, vec2<double>{{
+				1. * candidate_[idx].x / width_,
+				1. * candidate_[idx].y / height_}});
+			double val = leverage(touch_point_list_.data(), count_,
+				touch_xy_t{touch[0] * width_, touch[1] * height_}, width_, height_);
+			if (val > best)
+			{
+				best = val;
+				next_ = idx;
+			}
+		}
+		if (next_ >= candidate_count_)
+			return false;
+	}
+	point = candidate_[next_];
+	return true;
+}
+
+bool target_placement_t::add(touch_xy_t touch)
+{
+	used_[next_] = true;
+	touch_point_list_[count_] = touch_point_t{candidate_[next_], touch};
+	++count_;
+	if (count_ < NUM_POINTS)
+		return true;
+
+	matrix_ = transform_matrix_lsq(touch_point_list_.data(), count_, width_, height_);
+	if (!transform_matrix_valid(matrix_))
+		return false;
+	quality_ = calibration_quality(touch_point_list_.data(), count_, matrix_, width_, height_);
+	solved_ = true;
+	done_ = quality_.loo_rms_px <= tolerance_px_;
+	LOG("targets: %zu loo_rms_px: %f tolerance_px: %f", count_, quality_.loo_rms_px, tolerance_px_);
+	return true;
+}
@@ -0,0 +1,55 @@
+#ifndef TARGET_PLACEMENT_H
+#define TARGET_PLACEMENT_H
+
+#include "calibration_quality.h"
+#include "common.h"
+#include "transform_matrix.h"
+
+#include <array>
+
+// Adaptive calibration targets: the four corners first, then after every
+// provisional least squares fit the next target goes to the candidate where
+// the fit is least certain (highest leverage). Stops when the leave-one-out
+// RMS error is under tolerance or max_targets are taken.
+// Candidates are a grid x grid layout spanning the default corner targets.
+struct target_placement_t
+{
+	static constexpr size_t max_grid = 5;
+	static_assert(max_grid * max_grid <= max_touch_points, "candidates shall fit touch point storage");
+
+	target_placement_t(int width, int height, size_t grid, double tolerance_px, size_t max_targets);
+
+	// Next target, false when done.
+	bool next(xy_t& point);
+	// Touch for the target returned by next(). From the fourth touch on
+	// the matrix is refitted, false if it is not valid (misclicks).
+	bool add(touch_xy_t touch);
+
+	int width_;
+	int height_;
+	double tolerance_px_;
+	size_t max_targets_;
+	size_t grid_;
+	std::array<xy_t, max_grid * max_grid> candidate_;
+	std::array<bool, max_grid * max_grid> used_;
+	size_t candidate_count_;
+	size_t next_;           // candidate of the shown target
+	std::array<touch_point_t, max_touch_points> touch_point_list_;
+	size_t count_;
+	bool solved_;           // matrix_ and quality_ are set
+	bool done_;
+	transform_matrix_t matrix_;
+	calibration_quality_t quality_;
+};
+
+// grid x grid targets with 1/9 screen margins, row by row, 2x2 is UL UR LL LR.
+size_t target_grid(int width, int height, size_t grid, xy_t* out, size_t size);
+// Half of the smallest distance between targets: a touch within it of a target
+// is nearer to that target than to any other.
+double target_match_radius(const xy_t* target, size_t count);
+// Nearest target not taken within max_distance, count if none.
+size_t target_nearest(const xy_t* target, const bool* taken, size_t count, touch_xy_t xy, double max_distance);
+// Screen position of the touch through matr (e.g. provisional fit), pixels.
+touch_xy_t target_predict(const transform_matrix_t& matr, touch_xy_t touch, int width, int height);
+
+#endif  // TARGET_PLACEMENT_H
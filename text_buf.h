@@ -0,0 +1,122 @@
+#ifndef TEXT_BUF_H
+#define TEXT_BUF_H
+
+// Text formatting into caller owned storage, no heap allocation.
+// Output longer than the storage is truncated and overflow is set.
+
+#include <array>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// JSON string literal of str: quotes, backslashes and control characters escaped.
+// Pieces go to out(const char* data, size_t len), nothing is allocated here.
+template <typename Out>
+inline void json_escape(const char* str, Out out)
+{
+	out("\"", 1);
+	for (; *str != '\0'; ++str)
+	{
+		unsigned char ch = *str;
+		char buf[8];
+		if (ch == '"' || ch == '\\')
+		{
+			buf[0] = '\\';
+			buf[1] = *str;
+			out(buf, 2);
+		}
+		else if (ch < 0x20)
+			out(buf, snprintf(buf, sizeof(buf), "\\u%04x", ch));
+		else
+			out(str, 1);
+	}
+	out("\"", 1);
+}
+
+struct text_buf_t
+{
+	template <size_t N>
+	explicit text_buf_t(std::array<char, N>& storage)
+	: data_(storage.data())
+	, size_(N)
+	, len_(0)
+	, overflow_(false)
+	{
+		static_assert(N > 0, "text_buf_t needs storage");
+		data_[0] = '\0';
+	}
+
+	// Storage sized at run time, size > 0.
+	text_buf_t(char* data, size_t size)
+	: data_(data)
+	, size_(size)
+	, len_(0)
+	, overflow_(false)
+	{
+		data_[0] = '\0';
+	}
+
+	void clear()
+	{
+		len_ = 0;
+		overflow_ = false;
+		data_[0] = '\0';
+	}
+
+	text_buf_t& append(const char* str)
+	{
+		return append(str, strlen(str));
+	}
+
+	text_buf_t& append(const char* str, size_t len)
+	{
+		size_t room = size_ - 1 - len_;
+		if (len > room)
+		{
+			len = room;
+			overflow_ = true;
+		}
+		memcpy(data_ + len_, str, len);
+		len_ += len;
+		data_[len_] = '\0';
+		return *this;
+	}
+
+	text_buf_t& printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+	{
+		va_list args;
+		va_start(args, format);
+		int len = vsnprintf(data_ + len_, size_ - len_, format, args);
+		va_end(args);
+		if (len < 0)
+			overflow_ = true;
+		else if (static_cast<size_t>(len) >= size_ - len_)
+		{
+			len_ = size_ - 1;
+			overflow_ = true;
+		}
+		else
+			len_ += len;
+		return *this;
+	}
+
+	// JSON string literal, see json_escape().
+	text_buf_t& append_json_str(const char* str)
+	{
+		json_escape(str, [this](const char* data, size_t len){ append(data, len); });
+		return *this;
+	}
+
+	const char* c_str() const { return data_; }
+	size_t length() const { return len_; }
+	bool overflow() const { return overflow_; }
+
+private:
+	char* data_;
+	size_t size_;
+	size_t len_;
+	bool overflow_;
+};
+
+#endif  // TEXT_BUF_H
@@ -48,13 +48,20 @@ bool calibratable(XDeviceInfoPtr info)
 
 device_info_list_t device_info_list_get()
 {
-	device_info_list_t device_info_list;
-
     Display* display = XOpenDisplay(NULL);
     if (display == NULL) {
         ERR("Unable to connect to X server");
-        return device_info_list;
+        return device_info_list_t{};
     }
+    device_info_list_t device_info_list = device_info_list_get(display);
+    XCloseDisplay(display);
+
+	return device_info_list;
+}
+
+device_info_list_t device_info_list_get(Display* display)
+{
+	device_info_list_t device_info_list;
 
     int xi_opcode, event, error;
     if (!XQueryExtension(display, "XInputExtension", &xi_opcode, &event, &error))
@@ -83,23 +90,21 @@ device_info_list_t device_info_list_get()
     }
 
     XFreeDeviceList(slist);
-    XCloseDisplay(display);
 
 	return device_info_list;
 }
 
-bool set_matrix(Display *dpy, int deviceid, const transform_matrix_t& matr)
+static bool matrix_atoms_get(Display *dpy, Atom& prop_float, Atom& prop_matrix)
 {
-	if (!transform_matrix_valid(matr))
-	{
-		ERR("failed: transform_matrix_valid()");
-		return false;
-	}
-
-	LOG("deviceid: %d", deviceid);
-	
-	Atom prop_float = XInternAtom(dpy, "FLOAT", False);
-	Atom prop_matrix = XInternAtom(dpy, "Coordinate Transformation Matrix", False);
+	// Both atoms in one request: one round trip instead of two.
+	char* atom_names[] = {
+		const_cast<char*>("FLOAT"),
+		const_cast<char*>("Coordinate Transformation Matrix")
+		};
+	Atom atoms[2]{};
+	XInternAtoms(dpy, atom_names, 2, False, atoms);
+	prop_float = atoms[0];
+	prop_matrix = atoms[1];
 
 	if (!prop_float)
 	{
@@ -112,7 +117,12 @@ bool set_matrix(Display *dpy, int deviceid, const transform_matrix_t& matr)
 				"server is too old\n");
 		return false;
 	}
+	return true;
+}
 
+// Returned data shall be freed with XFree().
+static unsigned char* matrix_property_get(Display *dpy, int deviceid, Atom prop_float, Atom prop_matrix)
+{
 	int format_return;
 	Atom type_return;
 	unsigned long nitems;
@@ -125,15 +135,57 @@ bool set_matrix(Display *dpy, int deviceid, const transform_matrix_t& matr)
 		nitems != 9 || bytes_after != 0 || prop_matrix_data == nullptr)
 	{
 		ERR("Failed to retrieve current property values\n");
+		if (prop_matrix_data != nullptr)
+			XFree(prop_matrix_data);
+		return nullptr;
+	}
+	return prop_matrix_data;
+}
+
+bool get_matrix(Display *dpy, int deviceid, transform_matrix_t& matr)
+{
+	Atom prop_float;
+	Atom prop_matrix;
+	if (!matrix_atoms_get(dpy, prop_float, prop_matrix))
+		return false;
+
+	unsigned char* prop_matrix_data = matrix_property_get(dpy, deviceid, prop_float, prop_matrix);
+	if (prop_matrix_data == nullptr)
+		return false;
+
+	float* prop_matrix_data_float = reinterpret_cast<float*>(prop_matrix_data);
+	for (size_t idx = 0; idx < 9; idx++)
+		matr[idx] = prop_matrix_data_float[idx];
+
+	XFree(prop_matrix_data);
+	return true;
+}
+
+bool set_matrix(Display *dpy, int deviceid, const transform_matrix_t& matr)
+{
+	if (!transform_matrix_valid(matr))
+	{
+		ERR("failed: transform_matrix_valid()");
 		return false;
 	}
 
+	LOG("deviceid: %d", deviceid);
+
+	Atom prop_float;
+	Atom prop_matrix;
+	if (!matrix_atoms_get(dpy, prop_float, prop_matrix))
+		return false;
+
+	unsigned char* prop_matrix_data = matrix_property_get(dpy, deviceid, prop_float, prop_matrix);
+	if (prop_matrix_data == nullptr)
+		return false;
+
 	float* prop_matrix_data_float = reinterpret_cast<float*>(prop_matrix_data);
 	for (size_t idx = 0; idx < 9; idx++)
 		prop_matrix_data_float[idx] = matr[idx];
 
 	XIChangeProperty(dpy, deviceid, prop_matrix, prop_float,
-					 format_return, PropModeReplace, prop_matrix_data, nitems);
+					 32, PropModeReplace, prop_matrix_data, 9);
 
 	XFree(prop_matrix_data);
 	XSync(dpy, False);
@@ -141,6 +193,33 @@ bool set_matrix(Display *dpy, int deviceid, const transform_matrix_t& matr)
 	return true;
 }
 
+std::string device_node_get(Display *dpy, int deviceid)
+{
+	Atom prop_node = XInternAtom(dpy, "Device Node", True);
+	if (!prop_node)
+	{
+		ERR("Device Node atom not found, no device reports it");
+		return std::string{};
+	}
+
+	int format_return;
+	Atom type_return;
+	unsigned long nitems;
+	unsigned long bytes_after;
+	unsigned char* data = nullptr;
+	int rc = XIGetProperty(dpy, deviceid, prop_node, 0, 1024, False, XA_STRING,
+					   &type_return, &format_return, &nitems, &bytes_after, &data);
+	std::string node;
+	if (rc == Success && type_return == XA_STRING && format_return == 8 && data != nullptr)
+		node.assign(reinterpret_cast<char*>(data), nitems);
+	else
+		ERR("failed: XIGetProperty(): deviceid: %d has no Device Node", deviceid);
+	if (data != nullptr)
+		XFree(data);
+	LOG("deviceid: %d node: %s", deviceid, node.c_str());
+	return node;
+}
+
 #ifdef TOUCH_DEVICE_TEST
 
 bool verbose = true;
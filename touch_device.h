@@ -18,6 +18,11 @@ struct device_info_t
 using device_info_list_t = std::vector<device_info_t>;
 
 device_info_list_t device_info_list_get();
+// Uses existing connection, so it can run on a separate thread with its own display.
+device_info_list_t device_info_list_get(Display* display);
+bool get_matrix(Display *dpy, int deviceid, transform_matrix_t& matr);
 bool set_matrix(Display *dpy, int deviceid, const transform_matrix_t& matr);
+// Kernel evdev node of the device (XI "Device Node" property), empty if unknown.
+std::string device_node_get(Display *dpy, int deviceid);
 
 #endif  // TOUCH_DEVICE_H
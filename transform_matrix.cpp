@@ -26,63 +26,149 @@
 #include "log.h"
 
 #include <cmath>
+#include <array>
 #include <string>
-#include <sstream>
 
-struct tm_xy_t
+static transform_matrix_t transform_matrix_invalid()
 {
-	double x;
-	double y;
-};
+	return transform_matrix_t{NAN, NAN, NAN, NAN, NAN, NAN, 0, 0, 1};
+}
 
-transform_matrix_t transform_matrix(const touch_point_list_t& touch_point_list, int width, int height)
+// Row of the matrix mapping the line p0 -> p1 (normalized touch coordinates)
+// to span screen coordinates from offset to offset + span.
+// Returns false if p0 and p1 coincide.
+template <typename T>
+static bool axis_row(vec2<T> p0, vec2<T> p1, T span, T offset, vec3<T>& row)
 {
-	double width_coef = 1. * touch_point_list[UL].point.x / width;
-	double height_coef = 1. *
-		(touch_point_list[LR].point.y - touch_point_list[UR].point.y)/
-		height;
+	vec2<T> d = p1 - p0;
+	T len2 = dot(d, d);
+	if (abs_val(len2) <= scalar_traits<T>::singular())
+		return false;
+	vec2<T> ab = d * (span / len2);
+	row = vec3<T>{{ab[0], ab[1], offset - dot(ab, p0)}};
+	return true;
+}
+
+// Solver values in the log: fixed point as its raw integer, so the FIXED build
+// converts to floating point only at the input and the result.
+static void log_scalar(const char* name, double val)
+{
+	LOG("%s:%f", name, val);
+}
+
+template <typename Int, typename Wide, int Frac>
+static void log_scalar(const char* name, fixed_t<Int, Wide, Frac> val)
+{
+	LOG("%s:%lld/2^%d", name, static_cast<long long>(val.raw), Frac);
+}
+
+// Touch positions are converted to T once, fixed point T needs no floating point
+// after that until the result is converted to transform_matrix_t.
+template <typename T>
+transform_matrix_t transform_matrix_solve(const touch_point_list_t& touch_point_list, int width, int height)
+{
+	T width_coef = T(touch_point_list[UL].point.x) / T(width);
+	T height_coef = T(touch_point_list[LR].point.y - touch_point_list[UR].point.y) / T(height);
 
 	LOG("width:%d height:%d", width, height);
 	LOG("touch_point_list[UL].point.x:%d touch_point_list[LR].point.y:%d", touch_point_list[UL].point.x, touch_point_list[LR].point.y);
-	LOG("width_coef:%f height_coef:%f", width_coef, height_coef);
-	std::array<tm_xy_t, 4> clicks;
+	log_scalar("width_coef", width_coef);
+	log_scalar("height_coef", height_coef);
+	std::array<vec2<T>, 4> clicks;
 	for(size_t idx = 0;
 		idx < touch_point_list.size() && idx < clicks.size();
 		++idx)
 	{
-		tm_xy_t xy{};
-		xy.x = touch_point_list[idx].touch.x;
-		xy.y = touch_point_list[idx].touch.y;
-		clicks[idx].x = xy.x / width;
-		clicks[idx].y = xy.y / height;
+		clicks[idx] = vec2<T>{{
+			T(touch_point_list[idx].touch.x) / T(width),
+			T(touch_point_list[idx].touch.y) / T(height)}};
+	}
+	vec2<T> x0 = (clicks[UL] + clicks[LL]) / T(2);
+	vec2<T> x1 = (clicks[UR] + clicks[LR]) / T(2);
+	vec2<T> y0 = (clicks[UL] + clicks[UR]) / T(2);
+	vec2<T> y1 = (clicks[LL] + clicks[LR]) / T(2);
+	vec3<T> row_x{};
+	vec3<T> row_y{};
+	if (!axis_row(x0, x1, height_coef, width_coef, row_x) ||
+		!axis_row(y0, y1, height_coef, width_coef, row_y))
+		return transform_matrix_invalid();
+
+	mat33<T> matr{{
+		{row_x[0], row_x[1], row_x[2]},
+		{row_y[0], row_y[1], row_y[2]},
+		{T(0), T(0), T(1)}}};
+	return to_transform_matrix(matr);
+}
+
+transform_matrix_t transform_matrix(const touch_point_list_t& touch_point_list, int width, int height)
+{
+	return transform_matrix_solve<transform_scalar_t>(touch_point_list, width, height);
+}
+
+// Normal equations (X^T X) [a b c]^T = X^T u, X rows are (tx, ty, 1),
+// both output rows share X^T X.
+template <typename T>
+transform_matrix_t transform_matrix_lsq_solve(const touch_point_t* touch_point_list, size_t count, int width, int height)
+{
+	mat33<T> xtx = mat33<T>::zero();
+	mat<3, 2, T> xtu = mat<3, 2, T>::zero();
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		vec3<T> t{{
+			T(touch_point_list[idx].touch.x) / T(width),
+			T(touch_point_list[idx].touch.y) / T(height),
+			T(1)}};
+		T u = T(touch_point_list[idx].point.x) / T(width);
+		T v = T(touch_point_list[idx].point.y) / T(height);
+		for (size_t row = 0; row < 3; ++row)
+		{
+			for (size_t col = 0; col < 3; ++col)
+				xtx.m[row][col] += t[row] * t[col];
+			xtu.m[row][0] += t[row] * u;
+			xtu.m[row][1] += t[row] * v;
+		}
+	}
+	// fixed point rounding leaves near singular systems with small nonzero pivots
+	bool singular = count < 3 ||
+		(scalar_traits<T>::singular() != T(0) && abs_val(determinant(xtx)) <= scalar_traits<T>::singular());
+	if (singular || !solve(xtx, xtu))
+	{
+		LOG("singular system, count: %zu", count);
+		return transform_matrix_invalid();
 	}
-	double x0x = (clicks[0].x + clicks[2].x) / 2;
-	double x0y = (clicks[0].y + clicks[2].y) / 2;
-	double x1x = (clicks[1].x + clicks[3].x) / 2;
-	double x1y = (clicks[1].y + clicks[3].y) / 2;
-	double y0x = (clicks[0].x + clicks[1].x) / 2;
-	double y0y = (clicks[0].y + clicks[1].y) / 2;
-	double y1x = (clicks[2].x + clicks[3].x) / 2;
-	double y1y = (clicks[2].y + clicks[3].y) / 2;
-	double dxx = x1x - x0x;
-	double dxy = x1y - x0y;
-	double dyx = y1x - y0x;
-	double dyy = y1y - y0y;
-	double a = height_coef * (dxx / (( dxx *  dxx) + (dxy *  dxy)));
-	double b = height_coef * (dxy / (( dxx *  dxx) + (dxy *  dxy)));
-	double c = width_coef - (a * x0x) - (b *  x0y);
-	double d = height_coef * (dyx / ((dyx *  dyx) + (dyy *  dyy)));
-	double e = height_coef * (dyy / ((dyx *  dyx) + (dyy *  dyy)));
-	double f = width_coef - (d *  y0x) - (e *  y0y);
-
-	return transform_matrix_t{
-		static_cast<float>(a),
-		static_cast<float>(b),
-		static_cast<float>(c),
-		static_cast<float>(d),
-		static_cast<float>(e),
-		static_cast<float>(f),
-		0, 0, 1};
+	mat33<T> matr = mat33<T>::identity();
+	for (size_t col = 0; col < 3; ++col)
+	{
+		matr.m[0][col] = xtu.m[col][0];
+		matr.m[1][col] = xtu.m[col][1];
+	}
+	return to_transform_matrix(matr);
+}
+
+transform_matrix_t transform_matrix_lsq(const touch_point_t* touch_point_list, size_t count, int width, int height)
+{
+	return transform_matrix_lsq_solve<transform_scalar_t>(touch_point_list, count, width, height);
+}
+
+template transform_matrix_t transform_matrix_solve<double>(const touch_point_list_t&, int, int);
+template transform_matrix_t transform_matrix_solve<q16_16_t>(const touch_point_list_t&, int, int);
+template transform_matrix_t transform_matrix_solve<q32_32_t>(const touch_point_list_t&, int, int);
+template transform_matrix_t transform_matrix_lsq_solve<double>(const touch_point_t*, size_t, int, int);
+template transform_matrix_t transform_matrix_lsq_solve<q16_16_t>(const touch_point_t*, size_t, int, int);
+template transform_matrix_t transform_matrix_lsq_solve<q32_32_t>(const touch_point_t*, size_t, int, int);
+
+transform_matrix_t transform_matrix_compose(const transform_matrix_t& second, const transform_matrix_t& first)
+{
+	return to_transform_matrix(to_mat<double>(second) * to_mat<double>(first));
+}
+
+bool transform_matrix_inverse(const transform_matrix_t& matr, transform_matrix_t& inv)
+{
+	mat33<double> res{};
+	if (!inverse(to_mat<double>(matr), res))
+		return false;
+	inv = to_transform_matrix(res);
+	return true;
 }
 
 bool transform_matrix_valid(const transform_matrix_t& matr)
@@ -95,10 +181,17 @@ bool transform_matrix_valid(const transform_matrix_t& matr)
 	return true;
 }
 
-std::string transform_matrix_to_str(const transform_matrix_t& matr)
+bool transform_matrix_str(const transform_matrix_t& matr, text_buf_t& out)
 {
-	std::stringstream ss;
 	for (const auto& val : matr)
-		ss << val << " ";
-	return ss.str();
+		out.printf("%g ", val);
+	return !out.overflow();
+}
+
+std::string transform_matrix_to_str(const transform_matrix_t& matr)
+{
+	std::array<char, 256> storage;
+	text_buf_t out(storage);
+	transform_matrix_str(matr, out);
+	return out.c_str();
 }
@@ -2,6 +2,9 @@
 #define TRANSFORM_MATRIX_H
 
 #include "common.h"
+#include "fixed_point.h"
+#include "matrix.h"
+#include "text_buf.h"
 
 #include <array>
 #include <string>
@@ -9,8 +12,59 @@
 
 using transform_matrix_t = std::array<float, 9>;
 
+// Numeric policy of the solvers, selected at compile time:
+// make FIXED=16 - Q16.16, make FIXED=32 - Q32.32, else double.
+#if XORGCAL_FIXED_POINT == 16
+using transform_scalar_t = q16_16_t;
+#elif XORGCAL_FIXED_POINT == 32
+using transform_scalar_t = q32_32_t;
+#else
+using transform_scalar_t = double;
+#endif
+
+// Solvers computed in scalar type T, instantiated for double, q16_16_t and q32_32_t.
+template <typename T>
+transform_matrix_t transform_matrix_solve(const touch_point_list_t& touch_point_list, int width, int height);
+template <typename T>
+transform_matrix_t transform_matrix_lsq_solve(const touch_point_t* touch_point_list, size_t count, int width, int height);
+
+// transform_matrix_solve<transform_scalar_t>()
 transform_matrix_t transform_matrix(const touch_point_list_t& touch_point_list, int width, int height);
+// Least squares affine fit over any number (>= 3) of touch points.
+transform_matrix_t transform_matrix_lsq(const touch_point_t* touch_point_list, size_t count, int width, int height);
 bool transform_matrix_valid(const transform_matrix_t& matr);
+// Appends the values to out, no heap allocation, false if they do not fit.
+bool transform_matrix_str(const transform_matrix_t& matr, text_buf_t& out);
 std::string transform_matrix_to_str(const transform_matrix_t& matr);
 
+constexpr transform_matrix_t transform_matrix_identity()
+{
+	return transform_matrix_t{
+		1.0, 0.0, 0.0,
+		0.0, 1.0, 0.0,
+		0.0, 0.0, 1.0};
+}
+
+template <typename T>
+constexpr mat33<T> to_mat(const transform_matrix_t& matr)
+{
+	mat33<T> res{};
+	for (size_t idx = 0; idx < matr.size(); ++idx)
+		res.m[idx / 3][idx % 3] = static_cast<T>(matr[idx]);
+	return res;
+}
+
+template <typename T>
+inline transform_matrix_t to_transform_matrix(const mat33<T>& matr)
+{
+	transform_matrix_t res{};
+	for (size_t idx = 0; idx < res.size(); ++idx)
+		res[idx] = static_cast<float>(matr.m[idx / 3][idx % 3]);
+	return res;
+}
+
+// Result applies second after first.
+transform_matrix_t transform_matrix_compose(const transform_matrix_t& second, const transform_matrix_t& first);
+bool transform_matrix_inverse(const transform_matrix_t& matr, transform_matrix_t& inv);
+
 #endif  // TRANSFORM_MATRIX_H
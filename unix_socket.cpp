@@ -0,0 +1,119 @@
+#include "unix_socket.h"
+#include "log.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A socket is stale when nobody is bound to it: connect() is refused.
+// False if the path exists and is not a socket or a server is still there.
+static bool stale_socket_remove(const sockaddr_un& addr, int type)
+{
+	const char* socket_path = addr.sun_path;
+	struct stat st{};
+	if (lstat(socket_path, &st) != 0)
+		return errno == ENOENT;
+	if (!S_ISSOCK(st.st_mode))
+	{
+		ERR("not a socket, left as is: %s", socket_path);
+		return false;
+	}
+	// non blocking: a server with a full backlog is busy, not gone
+	int fd = socket(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		ERR("failed: socket(): %s", strerror(errno));
+		return false;
+	}
+	int rc = connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+	int error = errno;
+	close(fd);
+	if (rc == 0 || error == EAGAIN || error == EINPROGRESS)
+	{
+		ERR("already running: a server is bound to %s", socket_path);
+		return false;
+	}
+	if (error != ECONNREFUSED)
+	{
+		ERR("failed: connect(): %s : %s, left as is", socket_path, strerror(error));
+		return false;
+	}
+	unlink(socket_path);
+	return true;
+}
+
+int unix_socket_bind(const char* socket_path, int type)
+{
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(addr.sun_path))
+	{
+		ERR("socket path too long: %s", socket_path);
+		return -1;
+	}
+	strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+	if (!stale_socket_remove(addr, type & ~(SOCK_CLOEXEC | SOCK_NONBLOCK)))
+		return -1;
+	int fd = socket(AF_UNIX, type, 0);
+	if (fd < 0)
+	{
+		ERR("failed: socket(): %s", strerror(errno));
+		return -1;
+	}
+	if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		ERR("failed: bind(): %s : %s", socket_path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void unix_socket_unlink(const char* socket_path)
+{
+	struct stat st{};
+	if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(socket_path);
+}
+
+bool unix_socket_peer_allowed(const ucred& cred)
+{
+	if (cred.uid != 0 && cred.uid != geteuid())
+	{
+		ERR("peer pid %d uid %d refused", cred.pid, cred.uid);
+		return false;
+	}
+	return true;
+}
+
+ssize_t unix_socket_recv(int fd, char* data, size_t size, ucred& cred)
+{
+	iovec iov{data, size};
+	union
+	{
+		cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(ucred))];
+	} control;
+	msghdr msg{};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	ssize_t len = recvmsg(fd, &msg, 0);
+	if (len < 0)
+		return len;
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_CREDENTIALS)
+	{
+		ERR("datagram without credentials, SO_PASSCRED not set?");
+		cred = ucred{0, static_cast<uid_t>(-1), static_cast<gid_t>(-1)};
+		return len;
+	}
+	memcpy(&cred, CMSG_DATA(cmsg), sizeof(cred));
+	return len;
+}
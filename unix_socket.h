@@ -0,0 +1,25 @@
+#ifndef UNIX_SOCKET_H
+#define UNIX_SOCKET_H
+
+// Unix socket bound to a filesystem path.
+// A stale socket left by a previous run (connect() refused) is removed. A socket
+// a server still listens on fails the bind: one instance per path. Any other file
+// at the path (regular file, symlink, directory) is never touched: bind fails instead.
+// Peer credentials: SO_PEERCRED for streams, unix_socket_recv() for datagrams.
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+// type - SOCK_DGRAM / SOCK_STREAM, flags may be or-ed (SOCK_CLOEXEC).
+// Returns bound fd or -1.
+int unix_socket_bind(const char* socket_path, int type);
+// Removes the path if it is still a socket.
+void unix_socket_unlink(const char* socket_path);
+
+// Same user as this process or root.
+bool unix_socket_peer_allowed(const ucred& cred);
+// recv() of a datagram with the sender credentials, fd needs SO_PASSCRED.
+// A datagram without credentials gets uid -1.
+ssize_t unix_socket_recv(int fd, char* data, size_t size, ucred& cred);
+
+#endif  // UNIX_SOCKET_H
@@ -1,23 +1,21 @@
-#include "common.h"
-#include "screen_x11.h"
-#include "touch_device.h"
-#include "transform_matrix.h"
+#include "xorgcal.h"
+#include "text_buf.h"
 #include "log.h"
 
+#include <X11/Xlib.h>
+
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <future>
 #include <iostream>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
 
-bool verbose = false;
-
 struct config_t
 {
 	bool list;
@@ -27,10 +25,26 @@ struct config_t
 	bool verbose;
 	std::string device_name;
 	int device_id = -1;
-	int screen_num = invalid_screen_num;
+	int screen_num = -1;
 	std::vector<std::string> message;
 	std::string output_filename;
 	int timeout = 0; // seconds 0 - forever
+	std::string quality_report;
+	double max_error = 0; // pixels 0 - off
+	int retries = 3;
+	std::string drift_socket;
+	double drift_threshold = 10; // pixels
+	std::string backend = "x11";
+	std::string evdev_node;
+	std::vector<std::string> displays;
+	bool adaptive;
+	double tolerance = 2; // pixels
+	int max_targets = 13;
+	int grid = 2;
+	bool multitouch = false;
+	std::string control_socket;
+	bool profile = false;
+	double profile_window = 10; // seconds
 };
 
 struct key_val_t
@@ -41,33 +55,26 @@ struct key_val_t
 
 key_val_t key_val_split(const std::string& str, const std::string& delimiter)
 {
-	char key[256]{};
-	char val[256]{};
-	const char* delimiter_ptr = strstr(str.c_str(), delimiter.c_str());
-	if (delimiter_ptr != nullptr)
-	{
-		int key_len = std::min(static_cast<size_t>(delimiter_ptr - str.c_str()), sizeof(key));
-		strncpy(key, str.c_str(), key_len);
-		strncpy(val, delimiter_ptr + delimiter.size(), sizeof(val));
-	}
-	else
-		strncpy(key, str.c_str(), sizeof(key));
-
-	return key_val_t{key, val};
+	size_t pos = str.find(delimiter);
+	if (pos == std::string::npos)
+		return key_val_t{str, std::string{}};
+	return key_val_t{str.substr(0, pos), str.substr(pos + delimiter.size())};
 }
 
-std::vector<std::string> parse_message(const std::string& str)
+// Splits in one pass, pieces are copied once.
+std::vector<std::string> split(const std::string& str, const std::string& delimiter)
 {
-	std::vector<std::string> message;
-	auto key_val = key_val_split(str, "\\n");
-	message.push_back(key_val.key);
-	while(!key_val.val.empty())
+	std::vector<std::string> list;
+	size_t start = 0;
+	for (size_t pos = str.find(delimiter); pos != std::string::npos; pos = str.find(delimiter, start))
 	{
-		key_val = key_val_split(key_val.val, "\\n");
-		message.push_back(key_val.key);
+		list.emplace_back(str, start, pos - start);
+		start = pos + delimiter.size();
 	}
-	
-	return message;
+	// trailing delimiter does not add empty piece
+	if (start < str.size() || list.empty())
+		list.emplace_back(str, start, std::string::npos);
+	return list;
 }
 
 config_t parse_opts(int argc, const char* argv[])
@@ -96,183 +103,128 @@ config_t parse_opts(int argc, const char* argv[])
 		else if (key_val.key == "screen_num")
 			config.screen_num = strtol(key_val.val.c_str(), NULL, 10);
 		else if (key_val.key == "message")
-			config.message = parse_message(key_val.val);
+			config.message = split(key_val.val, "\\n");
 		else if (key_val.key == "output_filename")
 			config.output_filename = key_val.val;
 		else if (key_val.key == "verbose")
 			config.verbose = true;
 		else if (key_val.key == "timeout")
 			config.timeout = strtol(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "quality_report")
+			config.quality_report = key_val.val;
+		else if (key_val.key == "max_error")
+			config.max_error = strtod(key_val.val.c_str(), NULL);
+		else if (key_val.key == "retries")
+			config.retries = std::max(0L, strtol(key_val.val.c_str(), NULL, 10));
+		else if (key_val.key == "drift_socket")
+			config.drift_socket = key_val.val;
+		else if (key_val.key == "drift_threshold")
+			config.drift_threshold = strtod(key_val.val.c_str(), NULL);
+		else if (key_val.key == "backend")
+			config.backend = key_val.val;
+		else if (key_val.key == "evdev_node")
+			config.evdev_node = key_val.val;
+		else if (key_val.key == "adaptive")
+			config.adaptive = true;
+		else if (key_val.key == "tolerance")
+			config.tolerance = strtod(key_val.val.c_str(), NULL);
+		else if (key_val.key == "max_targets")
+			config.max_targets = std::min(std::max(strtol(key_val.val.c_str(), NULL, 10), 4L), 25L);
+		else if (key_val.key == "grid")
+			config.grid = strtol(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "multitouch")
+			config.multitouch = true;
+		else if (key_val.key == "control_socket")
+			config.control_socket = key_val.val;
+		else if (key_val.key == "profile")
+			config.profile = true;
+		else if (key_val.key == "profile_window")
+			config.profile_window = strtod(key_val.val.c_str(), NULL);
+		else if (key_val.key == "displays")
+			config.displays = split(key_val.val, ",");
 
 	}
 	return config;
 }
 
-constexpr int cross_size = 100;
-
-void draw_touch_point(screen_x11_t& scr, xy_t xy, color_index_t color_index)
+bool write_file(const std::string& file_name, const char *data, size_t size)
 {
-	scr.cross(xy, cross_size, color_index);
-	scr.circle(xy, cross_size / 5, color_index);
+    FILE* fh = fopen(file_name.c_str(), "w");
+    if (fh == nullptr)
+    {
+        ERR("failed: fopen(): %s : %s", file_name.c_str(), strerror(errno));
+        return false;
+    }
+    ssize_t written = fwrite(data, 1, size, fh);
+    if (written != static_cast<ssize_t>(size))
+    {
+        ERR("failed: fwrite(): %s : %s", file_name.c_str(), strerror(errno));
+        fclose(fh);
+        return false;
+    }
+    fclose(fh);
+    return true;
 }
 
-void draw_message(screen_x11_t& scr, const std::vector<std::string>& str_list)
+struct device_startup_t
 {
-	int max_width = -1;
-	for (const auto str : str_list)
-		max_width = std::max(max_width, scr.text_width(str.c_str()));
-	int line_spacing = scr.text_height() / 2;
-	int height = str_list.size() * (scr.text_height() + line_spacing);
-	int rect_offset = scr.text_height();
-	xy_t xy{};
-	xy.x = (scr.width_ / 2) - (max_width / 2);
-	xy.y = (scr.height_ / 2) - (height / 2);
-	rect_t rect{
-		{
-			(scr.width_ / 2) - ((max_width + rect_offset) / 2),
-			(scr.height_ / 2) - ((height + rect_offset) / 2)
-		},
-		{xy.x + max_width + rect_offset, xy.y + height + rect_offset}
-	};
-	scr.rect(rect, BLACK);
-
-	for(int idx = 0; idx < str_list.size(); ++idx)
-	{
-		scr.text(
-			{
-				(scr.width_ / 2) - (scr.text_width(str_list[idx].c_str()) / 2),
-				xy.y + ((idx + 1) * (scr.text_height() + line_spacing))
-			},
-			str_list[idx].c_str());
-	}
+	int device_id;
+	std::string device_name;
+	bool ok;
+};
+
+void device_selected(const xorgcal_device_t* device, void* user)
+{
+	device_startup_t* startup = static_cast<device_startup_t*>(user);
+	startup->device_id = device->id;
+	startup->device_name = device->name;
 }
 
-bool wait_touch_or_key(screen_x11_t& scr, xy_t& xy, size_t timeout_s)
+void device_ignore(const xorgcal_device_t*, void*)
 {
-	auto start = std::chrono::system_clock::now();
-	while(timeout_s == 0 ? true : std::chrono::system_clock::now() - start < std::chrono::seconds(timeout_s))
-	{
-		unsigned int keycode;
-		if (scr.get_touch_button_event(xy, keycode))
-		{
-			LOG("%d:%d", xy.x, xy.y);
-			return true;
-		}
-		else
-			if (keycode != 0)
-				return false;
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
-	}
-	ERR("timeout %zu sec. is over", timeout_s);
-	return false;
 }
 
-bool get_touch_point_list(screen_x11_t& scr, touch_point_list_t& touch_point_list, size_t timeout_s)
+// Device part of the startup: enumerate, select and reset the device.
+// Runs on its own X connection concurrently with the window creation,
+// so the first target is shown as soon as both are done.
+device_startup_t device_startup(const std::string& display_name, const config_t& config)
 {
-	for (size_t idx = 0; idx < touch_point_list.size(); ++idx)
+	device_startup_t startup{-1, "fake", false};
+	Display* display = XOpenDisplay(display_name.empty() ? NULL : display_name.c_str());
+	if (display == nullptr)
 	{
-		draw_touch_point(scr, touch_point_list[idx].point, RED);
-		if (idx > 0)
-			draw_touch_point(scr, touch_point_list[idx - 1].point, WHITE);
-
-		xy_t xy;
-		if (wait_touch_or_key(scr, xy, timeout_s))
-			touch_point_list[idx].touch = xy;
+		ERR("failed: XOpenDisplay(): Unable to connect to X server");
+		return startup;
+	}
+	if (config.fake)
+		startup.ok = xorgcal_device_list(display, device_ignore, nullptr) == XORGCAL_OK;
+	else if (xorgcal_device_select(display, config.device_name.c_str(), config.device_id,
+		device_selected, &startup) == XORGCAL_OK)
+	{
+		if (xorgcal_reset(display, startup.device_id) == XORGCAL_OK)
+			startup.ok = true;
 		else
-			return false;
+			ERR("failed: reset_calibration()");
 	}
-	return true;
+	XCloseDisplay(display);
+	return startup;
 }
 
-using matr33_row_t = std::array<float, 3>;
-using matr33_t = std::array<matr33_row_t, 3>;
-
-std::string xorg_str(const transform_matrix_t& transform_matrix, const char* device_name)
+void device_print(const xorgcal_device_t* device, void*)
 {
-    char line[1024];
-    std::string outstr;
-    outstr += "Section \"InputClass\"\n";
-    outstr += "	Identifier	\"calibration\"\n";
-    sprintf(line, "	MatchProduct	\"%s\"\n", device_name);
-    outstr += line;
-    sprintf(line, "	Option	\"TransformationMatrix\"	\"%f %f %f %f %f %f %f %f %f\"\n",
-		transform_matrix[0], transform_matrix[1], transform_matrix[2],
-		transform_matrix[3], transform_matrix[4], transform_matrix[5],
-		transform_matrix[6], transform_matrix[7], transform_matrix[8]
-		);
-    outstr += line;
-    outstr += "EndSection\n";
-    return outstr;
+	std::cout << "id: " << device->id << " \"" << device->name << "\" calibratable:" << device->calibratable << "\n";
 }
 
-std::string xinput_str(const transform_matrix_t& transform_matrix, const char* device_name)
+void text_print(const char* text, void*)
 {
-    char line[1024];
-    std::string outstr;
-    sprintf(line, "xinput set-prop \"%s\" \"Coordinate Transformation Matrix\" %f %f %f %f %f %f %f %f %f \n",
-		device_name,
-		transform_matrix[0], transform_matrix[1], transform_matrix[2],
-		transform_matrix[3], transform_matrix[4], transform_matrix[5],
-		transform_matrix[6], transform_matrix[7], transform_matrix[8]
-		);
-    outstr += line;
-	return outstr;
+	fputs(text, stdout);
 }
 
-device_info_t select_device(const device_info_list_t& dev_info_list, const config_t& config)
+// user - text_buf_t in storage allocated before the session
+void quality_append(const char* json, void* user)
 {
-	device_info_t device_info{.calibratable = false};
-	bool multiple = false;
-	for (auto info : dev_info_list)
-	{
-		if (config.device_id == info.xid)
-			return info;
-		if (config.device_name == info.name)
-			return info;
-		if (info.calibratable)
-		{
-			if (device_info.calibratable)
-				multiple = true;
-			device_info = info;
-		}
-	}
-	if (multiple)
-		ERR("Warning: multiple calibratable devices found, calibrating last one (%s)\n\t"
-			"use --device to select another one.\n", device_info.name.c_str());
-	if (!device_info.calibratable && !config.device_name.empty())
-		ERR("Error: Device \"%s\" not found; use --list to list the calibratable input devices.\n", config.device_name.c_str());
-	if (!device_info.calibratable && config.device_id != -1)
-		ERR("Error: Device id: %d not found; use --list to list the calibratable input devices.\n", config.device_id);
-	return device_info;
-}
-
-bool write_file(const std::string& file_name, const char *data, size_t size)
-{
-    FILE* fh = fopen(file_name.c_str(), "w");
-    if (fh == nullptr)
-    {
-        ERR("failed: fopen(): %s : %s", file_name.c_str(), strerror(errno));
-        return false;
-    }
-    ssize_t written = fwrite(data, 1, size, fh);
-    if (written != static_cast<ssize_t>(size))
-    {
-        ERR("failed: fwrite(): %s : %s", file_name.c_str(), strerror(errno));
-        fclose(fh);
-        return false;
-    }
-    fclose(fh);
-    return true;
-}
-
-bool reset_calibration(Display *display, int deviceid)
-{
-	transform_matrix_t transform_matrix{
-		1.0, 0.0, 0.0,
-		0.0, 1.0, 0.0,
-		0.0, 0.0, 1.0
-		};
-	return set_matrix(display, deviceid, transform_matrix);
+	text_buf_t* report = static_cast<text_buf_t*>(user);
+	report->append(json).append("\n");
 }
 
 void usage()
@@ -290,9 +242,29 @@ void usage()
 		<< "h or help - output this help message\n"
 		<< "screen_num - number of the screen to calibrate\n"
 		<< "message - message to show on calibration screen. Strings separated by \\n. UTF8 is supported\n"
-		<< "output_filename - name of the file to write callibration config to\n"
+		<< "output_filename - name of the xorg.conf.d file to write callibration config to,\n"
+		<< "                  section of the device is updated, other sections are kept\n"
 		<< "verbose - print a lot of log messages\n"
 		<< "timeout - seconds to wait for users touches. Default - wait forever\n"
+		<< "quality_report - name of the file to write calibration quality JSON to, one line per attempt\n"
+		<< "max_error - pixels, ask to repeat calibration if any target error is larger. Default - off\n"
+		<< "retries - how many times to repeat inaccurate calibration. Default - 3\n"
+		<< "drift_socket - run drift monitor: receive taps on known targets on this unix socket\n"
+		<< "               and update matrix of the device when calibration drifts\n"
+		<< "drift_threshold - pixels of drift before matrix update. Default - 10\n"
+		<< "backend - where touches are read from: x11 or evdev (kernel device node, raw axes). Default - x11\n"
+		<< "evdev_node - device node for evdev backend. Default - \"Device Node\" property of the device\n"
+		<< "adaptive - place targets where calibration is least certain until it is accurate enough\n"
+		<< "tolerance - pixels, adaptive calibration stops when estimated error is below. Default - 2\n"
+		<< "max_targets - adaptive calibration targets limit, 4..25. Default - 13\n"
+		<< "grid - N x N targets, 2..5, above 2 matrix is fitted by least squares. Default - 2\n"
+		<< "multitouch - show all targets at once, concurrent touches are matched to the nearest targets\n"
+		<< "displays - comma separated X displays to calibrate concurrently, one session per display\n"
+		<< "control_socket - run control server: list, reset, apply and calibrate requests on this unix socket,\n"
+		<< "                 progress events streamed back, other options are calibrate defaults\n"
+		<< "profile - print input latency profile JSON of the device: event rate, latency percentiles,\n"
+		<< "          jitter and coalescing of XI2 raw and cooked events, nothing is calibrated\n"
+		<< "profile_window - seconds to capture events for profile. Default - 10\n"
 		<< "\n\n"
 		<< "If no 'device_name' or 'device_id' option given last calibratible device is selected.\n"
 		<< "\n\n"
@@ -302,108 +274,340 @@ void usage()
 		;
 }
 
+#ifdef STARTUP_BENCH
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time from start to the window ready for drawing the first target.
+// Run with "fake" to leave device calibration untouched.
 int main(int argc, const char* argv[])
 {
+	XInitThreads();
 	config_t config = parse_opts(argc, argv);
-	verbose = config.verbose;
-	device_info_list_t dev_info_list = device_info_list_get();
-	if (config.help)
+	xorgcal_set_verbose(config.verbose);
+	xorgcal_options_t options;
+	xorgcal_options_init(&options);
+	options.screen_num = config.screen_num;
+	constexpr int iterations = 20;
+	double sequential_ms = 0;
+	double overlapped_ms = 0;
+	for (int idx = 0; idx < iterations; ++idx)
 	{
-		usage();
-		return EXIT_SUCCESS;
+		auto start = std::chrono::steady_clock::now();
+		{
+			Display* display = XOpenDisplay(NULL);
+			ASSERT(display != nullptr);
+			device_startup_t startup = device_startup("", config);
+			xorgcal_session_t* session = xorgcal_session_new(display, &options);
+			XSync(display, False);
+			sequential_ms += elapsed_ms(start);
+			ASSERT(startup.ok && session != nullptr);
+			xorgcal_session_free(session);
+			XCloseDisplay(display);
+		}
+
+		start = std::chrono::steady_clock::now();
+		{
+			std::future<device_startup_t> startup_future =
+				std::async(std::launch::async, device_startup, std::string(), std::cref(config));
+			Display* display = XOpenDisplay(NULL);
+			ASSERT(display != nullptr);
+			xorgcal_session_t* session = xorgcal_session_new(display, &options);
+			XSync(display, False);
+			device_startup_t startup = startup_future.get();
+			overlapped_ms += elapsed_ms(start);
+			ASSERT(startup.ok && session != nullptr);
+			xorgcal_session_free(session);
+			XCloseDisplay(display);
+		}
 	}
+	printf("sequential: %.3f ms\n", sequential_ms / iterations);
+	printf("overlapped: %.3f ms\n", overlapped_ms / iterations);
+	return EXIT_SUCCESS;
+}
 
-	if (config.list)
+#else  // STARTUP_BENCH
+
+// Result of one display calibration, printed or aggregated by the caller.
+struct seat_result_t
+{
+	std::string display_name;
+	int rc;
+	std::string device_name;
+	std::array<float, 9> matrix;
+	std::string quality_report;   // JSON line per attempt
+};
+
+// message keeps the line pointers options refer to.
+xorgcal_options_t session_options(const config_t& config, std::vector<const char*>& message)
+{
+	xorgcal_options_t options;
+	xorgcal_options_init(&options);
+	options.screen_num = config.screen_num;
+	options.timeout = config.timeout;
+	options.max_error_px = config.max_error;
+	options.retries = config.retries;
+	options.adaptive = config.adaptive;
+	options.tolerance_px = config.tolerance;
+	options.max_targets = config.max_targets;
+	options.grid = config.grid;
+	options.multitouch = config.multitouch;
+	for (const auto& line : config.message)
+		message.push_back(line.c_str());
+	if (!message.empty())
 	{
-		for (auto info : dev_info_list)
-			std::cout << "id: " << info.xid << " \"" << info.name << "\" calibratable:" << info.calibratable << "\n";
-		return EXIT_SUCCESS;
+		options.message = message.data();
+		options.message_lines = message.size();
 	}
+	return options;
+}
 
-	device_info_t device_info{.name = "fake"};
-	if (!config.fake)
+seat_result_t calibrate_seat(Display* display, const std::string& display_name, const config_t& config)
+{
+	seat_result_t result{display_name, EXIT_FAILURE, "", {}, ""};
+	std::future<device_startup_t> startup_future =
+		std::async(std::launch::async, device_startup, std::cref(display_name), std::cref(config));
+
+	std::vector<const char*> message;
+	xorgcal_options_t options = session_options(config, message);
+	xorgcal_session_t* session = xorgcal_session_new(display, &options);
+	device_startup_t startup = startup_future.get();
+	if (session == nullptr)
+	{
+		ERR("failed: xorgcal_session_new(): %s", display_name.c_str());
+		return result;
+	}
+	if (!startup.ok)
+	{
+		xorgcal_session_free(session);
+		return result;
+	}
+	result.device_name = startup.device_name;
+	LOG("Selected device: id: %d \"%s\" ", startup.device_id, startup.device_name.c_str());
+
+	if (config.reset)
 	{
-		if (dev_info_list.empty())
+		xorgcal_session_free(session);
+		result.rc = EXIT_SUCCESS;
+		return result;
+	}
+
+	if (config.backend == "evdev")
+	{
+		if (config.fake && config.evdev_node.empty())
 		{
-			ERR("Error: No devices found.");
-			return EXIT_FAILURE;
+			ERR("evdev backend needs a device or evdev_node");
+			xorgcal_session_free(session);
+			return result;
 		}
-		device_info = select_device(dev_info_list, config);
-		if (!device_info.calibratable)
+		if (xorgcal_session_evdev(session, startup.device_id,
+			config.evdev_node.empty() ? nullptr : config.evdev_node.c_str()) != XORGCAL_OK)
 		{
-			ERR("Error: No calibratable devices found.");
-			return EXIT_FAILURE;
+			ERR("failed: xorgcal_session_evdev()");
+			xorgcal_session_free(session);
+			return result;
 		}
 	}
-	LOG("Selected device: id: %d \"%s\" ", device_info.xid, device_info.name.c_str());
+	else if (config.backend != "x11")
+	{
+		ERR("unknown backend: %s", config.backend.c_str());
+		xorgcal_session_free(session);
+		return result;
+	}
 
-	screen_x11_t scr(config.screen_num);
-	ASSERT(scr.is_valid);
-	LOG("scr.width_:%d scr.height_:%d", scr.width_, scr.height_);
+	xorgcal_callbacks_t callbacks;
+	xorgcal_callbacks_init(&callbacks);
+	callbacks.quality_report = quality_append;
+	// reports are appended during the session into storage allocated here
+	std::vector<char> report_storage(8192 * (config.retries + 1) * (config.adaptive ? config.max_targets : 1));
+	text_buf_t report(report_storage.data(), report_storage.size());
+	int rc = xorgcal_session_run(session, &callbacks, &report, result.matrix.data());
+	xorgcal_session_free(session);
+	if (report.overflow())
+		ERR("quality report truncated: %s", display_name.c_str());
+	result.quality_report = report.c_str();
+	if (rc != XORGCAL_OK)
+		return result;
 
 	if (!config.fake)
 	{
-		if (!reset_calibration(scr.display_, device_info.xid))
+		if (xorgcal_set_matrix(display, startup.device_id, result.matrix.data()) != XORGCAL_OK)
 		{
-			ERR("failed: reset_calibration()");
-			return EXIT_FAILURE;
+			ERR("failed: set_matrix()");
+			return result;
 		}
 	}
-	if (config.reset)
-		return EXIT_SUCCESS;
+	result.rc = EXIT_SUCCESS;
+	return result;
+}
 
-	std::vector<std::string> message{
-		"Touchscreen calibration",
-		"Press red cross center",
-		"Any key to abort"
-		};
-	if (!config.message.empty())
-		message = config.message;
-	draw_message(scr, message);
-
-	touch_point_list_t touch_point_list{};
-
-	int cross_offset_x = scr.width_ / 9;
-	int cross_offset_y = scr.height_ / 9;
-	touch_point_list[UL].point = {cross_offset_x, cross_offset_y};
-	touch_point_list[UR].point = {scr.width_ - cross_offset_x, cross_offset_y};
-	touch_point_list[LL].point = {cross_offset_x, scr.height_ - cross_offset_y};
-	touch_point_list[LR].point = {scr.width_ - cross_offset_x, scr.height_ - cross_offset_y};
-
-	if (!get_touch_point_list(scr, touch_point_list, config.timeout))
+int calibrate(Display* display, const config_t& config)
+{
+	seat_result_t result = calibrate_seat(display, "", config);
+	if (!config.quality_report.empty() && !result.quality_report.empty())
+		if (!write_file(config.quality_report, result.quality_report.c_str(), result.quality_report.length()))
+			return EXIT_FAILURE;
+	if (result.rc != EXIT_SUCCESS || config.reset)
+		return result.rc;
+
+	xorgcal_xorg_conf(result.matrix.data(), result.device_name.c_str(), text_print, nullptr);
+	if (!config.output_filename.empty())
 	{
-		ERR("Aborted");
-		return EXIT_FAILURE;
+		xorgcal_conf_device_t device{result.device_name.c_str(), {}};
+		std::copy(result.matrix.begin(), result.matrix.end(), device.matrix);
+		if (xorgcal_xorg_conf_update(config.output_filename.c_str(), &device, 1) != XORGCAL_OK)
+			return EXIT_FAILURE;
 	}
 
-	for (size_t idx = 0; idx < touch_point_list.size(); ++idx)
-		LOG("point: %d:%d\ttouch : %d:%d",
-			touch_point_list[idx].point.x, touch_point_list[idx].point.y,
-			touch_point_list[idx].touch.x, touch_point_list[idx].touch.y);
+	return EXIT_SUCCESS;
+}
 
-	transform_matrix_t transform_matrix = ::transform_matrix(touch_point_list, scr.width_, scr.height_);
-	if (!transform_matrix_valid(transform_matrix))
+// Calibration on its own connection, display is returned to be closed
+// after all seats are done (Xft close hook is not thread safe).
+seat_result_t calibrate_display(const std::string& display_name, const config_t& config, Display*& display)
+{
+	display = XOpenDisplay(display_name.c_str());
+	if (display == nullptr)
 	{
-		ERR("failed: transform_matrix_valid() transform_matrix: %s",
-			transform_matrix_to_str(transform_matrix).c_str());
-		ERR("Probably there were misclicks");
-		return EXIT_FAILURE;
+		ERR("failed: XOpenDisplay(): %s", display_name.c_str());
+		return seat_result_t{display_name, EXIT_FAILURE, "", {}, ""};
 	}
+	return calibrate_seat(display, display_name, config);
+}
 
-	if (!config.fake)
+// Multiseat: independent session per display, each on its own thread and connection.
+int calibrate_displays(const config_t& config)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::vector<Display*> display_list(config.displays.size(), nullptr);
+	std::vector<std::future<seat_result_t>> future_list;
+	for (size_t idx = 0; idx < config.displays.size(); ++idx)
+		future_list.push_back(std::async(std::launch::async, calibrate_display,
+			std::cref(config.displays[idx]), std::cref(config), std::ref(display_list[idx])));
+	std::vector<seat_result_t> result_list;
+	for (auto& future : future_list)
+		result_list.push_back(future.get());
+	for (Display* display : display_list)
+		if (display != nullptr)
+			XCloseDisplay(display);
+	double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	int rc = EXIT_SUCCESS;
+	// report and seat entry on the stack, as xorg.conf text
+	std::array<char, 256 * 1024> storage;
+	text_buf_t report(storage);
+	std::array<char, 64 * 1024> seat;
+	report.append("{\"seats\":[");
+	std::vector<xorgcal_conf_device_t> conf_device_list;
+	for (const auto& result : result_list)
 	{
-		if (!set_matrix(scr.display_, device_info.xid, transform_matrix))
+		seat[0] = '\0';
+		if (xorgcal_seat_report(result.display_name.c_str(), result.device_name.c_str(), result.rc == EXIT_SUCCESS,
+			result.matrix.data(), result.quality_report.c_str(), seat.data(), seat.size()) != XORGCAL_OK)
+			ERR("seat report truncated: %s", result.display_name.c_str());
+		report.append(&result == &result_list.front() ? "" : ",").append(seat.data());
+		if (result.rc != EXIT_SUCCESS)
 		{
-			ERR("failed: set_matrix()");
-			return EXIT_FAILURE;
+			ERR("calibration failed: %s", result.display_name.c_str());
+			rc = EXIT_FAILURE;
+			continue;
 		}
+		if (config.reset)
+			continue;
+		printf("# display %s\n", result.display_name.c_str());
+		xorgcal_xorg_conf(result.matrix.data(), result.device_name.c_str(), text_print, nullptr);
+		conf_device_list.push_back(xorgcal_conf_device_t{result.device_name.c_str(), {}});
+		std::copy(result.matrix.begin(), result.matrix.end(), conf_device_list.back().matrix);
 	}
+	report.printf("],\"wall_ms\":%.0f}\n", wall_ms);
+	if (report.overflow())
+		ERR("report truncated");
+	LOG("report: %s", report.c_str());
+
+	if (!config.quality_report.empty())
+		if (!write_file(config.quality_report, report.c_str(), report.length()))
+			rc = EXIT_FAILURE;
+	// all seats in one write
+	if (!config.output_filename.empty() && !conf_device_list.empty())
+		if (xorgcal_xorg_conf_update(config.output_filename.c_str(),
+			conf_device_list.data(), conf_device_list.size()) != XORGCAL_OK)
+			rc = EXIT_FAILURE;
+	return rc;
+}
 
-    std::string outstr = xorg_str(transform_matrix, device_info.name.c_str());
-    printf("%s", outstr.c_str());
-    if (!config.output_filename.empty())
-		if (!write_file(config.output_filename, outstr.c_str(), outstr.length()))
-			return EXIT_FAILURE;
+int drift_monitor(Display* display, const config_t& config)
+{
+	device_startup_t device{-1, "", false};
+	if (xorgcal_device_select(display, config.device_name.c_str(), config.device_id,
+		device_selected, &device) != XORGCAL_OK)
+		return EXIT_FAILURE;
+	LOG("Selected device: id: %d \"%s\" ", device.device_id, device.device_name.c_str());
+	xorgcal_drift_monitor(display, device.device_id, config.drift_socket.c_str(), config.drift_threshold);
+	return EXIT_FAILURE;
+}
 
+int profile(Display* display, const config_t& config)
+{
+	device_startup_t device{-1, "", false};
+	if (xorgcal_device_select(display, config.device_name.c_str(), config.device_id,
+		device_selected, &device) != XORGCAL_OK)
+		return EXIT_FAILURE;
+	LOG("Selected device: id: %d \"%s\" ", device.device_id, device.device_name.c_str());
+	if (xorgcal_input_profile(display, device.device_id, config.profile_window, text_print, nullptr) != XORGCAL_OK)
+		return EXIT_FAILURE;
+	printf("\n");
 	return EXIT_SUCCESS;
 }
+
+int control_server(Display* display, const config_t& config)
+{
+	std::vector<const char*> message;
+	xorgcal_options_t options = session_options(config, message);
+	xorgcal_control_server(display, config.control_socket.c_str(), &options);
+	return EXIT_FAILURE;
+}
+
+int main(int argc, const char* argv[])
+{
+	XInitThreads();
+	config_t config = parse_opts(argc, argv);
+	xorgcal_set_verbose(config.verbose);
+	// log lines reach a pipe reader (e.g. e2e_test) as they happen
+	if (config.verbose)
+		setvbuf(stdout, NULL, _IOLBF, 0);
+	if (config.help)
+	{
+		usage();
+		return EXIT_SUCCESS;
+	}
+
+	if (!config.displays.empty() && !config.list && config.drift_socket.empty() && config.control_socket.empty() &&
+		!config.profile)
+		return calibrate_displays(config);
+
+	Display* display = XOpenDisplay(NULL);
+	if (display == nullptr)
+	{
+		ERR("failed: XOpenDisplay(): Unable to connect to X server");
+		return EXIT_FAILURE;
+	}
+
+	int rc = EXIT_SUCCESS;
+	if (config.list)
+		xorgcal_device_list(display, device_print, nullptr);
+	else if (!config.drift_socket.empty())
+		rc = drift_monitor(display, config);
+	else if (!config.control_socket.empty())
+		rc = control_server(display, config);
+	else if (config.profile)
+		rc = profile(display, config);
+	else
+		rc = calibrate(display, config);
+	XCloseDisplay(display);
+	return rc;
+}
+
+#endif  // STARTUP_BENCH
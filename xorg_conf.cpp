@@ -0,0 +1,323 @@
+#include "xorg_conf.h"
+#include "calibration.h"
+#include "text_buf.h"
+#include "log.h"
+
+#include <array>
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Piece of the config text, not terminated.
+struct token_t
+{
+	const char* data;
+	size_t len;
+};
+
+// Keyword and the first argument are all a line is matched by.
+using line_tokens_t = std::array<token_t, 2>;
+
+// Keyword and quoted strings of a config line, comment dropped, up to tokens.size().
+static size_t line_tokens(const char* line, size_t len, line_tokens_t& tokens)
+{
+	size_t count = 0;
+	size_t pos = 0;
+	while (pos < len && count < tokens.size())
+	{
+		char ch = line[pos];
+		if (isspace(static_cast<unsigned char>(ch)))
+		{
+			++pos;
+			continue;
+		}
+		if (ch == '#')
+			break;
+		if (ch == '"')
+		{
+			const char* quote = static_cast<const char*>(memchr(line + pos + 1, '"', len - pos - 1));
+			size_t end = quote != nullptr ? quote - line : len;
+			tokens[count++] = token_t{line + pos + 1, end - pos - 1};
+			pos = end + 1;
+			continue;
+		}
+		size_t end = pos;
+		while (end < len && strchr(" \t\r\n\"#", line[end]) == nullptr)
+			++end;
+		tokens[count++] = token_t{line + pos, end - pos};
+		pos = end;
+	}
+	return count;
+}
+
+// xorg.conf keywords are case insensitive
+static bool token_is(const line_tokens_t& tokens, size_t count, size_t idx, const char* keyword)
+{
+	size_t len = strlen(keyword);
+	return count > idx && tokens[idx].len == len && strncasecmp(tokens[idx].data, keyword, len) == 0;
+}
+
+// Index of the device with the name, names in the list are unique.
+static int device_find(const xorg_conf_device_t* device_list, size_t count, const token_t& name)
+{
+	for (size_t idx = 0; idx < count; ++idx)
+		if (strlen(device_list[idx].name) == name.len && memcmp(device_list[idx].name, name.data, name.len) == 0)
+			return idx;
+	return -1;
+}
+
+// A section matches by name only: the same panel model on two seats can not get
+// two matrices, one of the calibrations would be lost.
+static bool names_unique(const xorg_conf_device_t* device_list, size_t count)
+{
+	for (size_t idx = 0; idx < count; ++idx)
+		for (size_t other = idx + 1; other < count; ++other)
+			if (strcmp(device_list[idx].name, device_list[other].name) == 0)
+			{
+				ERR("device \"%s\" is listed more than once, MatchProduct section holds one matrix",
+					device_list[idx].name);
+				return false;
+			}
+	return true;
+}
+
+// End of the line at pos: past its '\n' or end of the text.
+static size_t line_end(const char* text, size_t len, size_t pos)
+{
+	const char* newline = static_cast<const char*>(memchr(text + pos, '\n', len - pos));
+	return newline != nullptr ? newline - text + 1 : len;
+}
+
+// Lines as they are, the last one terminated.
+static void lines_append(const char* text, size_t len, text_buf_t& out)
+{
+	out.append(text, len);
+	if (len > 0 && text[len - 1] != '\n')
+		out.append("\n");
+}
+
+// InputClass section of len bytes, TransformationMatrix option of the device replaced.
+static void section_merge(const char* section, size_t len, const xorg_conf_device_t* device_list, size_t count,
+	bool* done, text_buf_t& out)
+{
+	line_tokens_t tokens;
+	int device_idx = -1;
+	for (size_t pos = 0; pos < len; pos = line_end(section, len, pos))
+	{
+		size_t token_count = line_tokens(section + pos, line_end(section, len, pos) - pos, tokens);
+		if (token_is(tokens, token_count, 0, "MatchProduct") && token_count > 1)
+			device_idx = device_find(device_list, count, tokens[1]);
+	}
+	if (device_idx < 0)
+	{
+		lines_append(section, len, out);
+		return;
+	}
+
+	std::array<char, 512> storage;
+	text_buf_t option(storage);
+	xorg_option_str(device_list[device_idx].matrix, option);
+	bool replaced = false;
+	for (size_t pos = 0; pos < len; )
+	{
+		size_t end = line_end(section, len, pos);
+		size_t token_count = line_tokens(section + pos, end - pos, tokens);
+		bool matrix_option = token_is(tokens, token_count, 0, "Option") &&
+			token_is(tokens, token_count, 1, "TransformationMatrix");
+		bool last = end == len;
+		// in place of the first old option, else before EndSection
+		if ((matrix_option || last) && !replaced)
+		{
+			out.append(option.c_str(), option.length());
+			replaced = true;
+		}
+		if (!matrix_option)
+			lines_append(section + pos, end - pos, out);
+		pos = end;
+	}
+	done[device_idx] = true;
+}
+
+bool xorg_conf_merge(const char* text, size_t len, const xorg_conf_device_t* device_list, size_t count,
+	text_buf_t& out)
+{
+	if (count > xorg_conf_max_devices)
+	{
+		ERR("failed: %zu devices, at most %zu in one update", count, xorg_conf_max_devices);
+		return false;
+	}
+	if (!names_unique(device_list, count))
+		return false;
+	std::array<bool, xorg_conf_max_devices> done{};
+	line_tokens_t tokens;
+	size_t section = 0;
+	bool in_section = false;
+	for (size_t pos = 0; pos < len; )
+	{
+		size_t end = line_end(text, len, pos);
+		size_t token_count = line_tokens(text + pos, end - pos, tokens);
+		if (!in_section)
+		{
+			if (token_is(tokens, token_count, 0, "Section") && token_is(tokens, token_count, 1, "InputClass"))
+			{
+				in_section = true;
+				section = pos;
+			}
+			else
+				lines_append(text + pos, end - pos, out);
+		}
+		else if (token_is(tokens, token_count, 0, "EndSection"))
+		{
+			section_merge(text + section, end - section, device_list, count, done.data(), out);
+			in_section = false;
+		}
+		pos = end;
+	}
+	// unterminated section is kept as is
+	if (in_section)
+		lines_append(text + section, len - section, out);
+
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		if (done[idx])
+			continue;
+		std::array<char, 2048> storage;
+		text_buf_t section_str(storage);
+		if (!xorg_str(device_list[idx].matrix, device_list[idx].name, section_str))
+		{
+			ERR("failed: xorg_str(): device name is too long");
+			return false;
+		}
+		if (out.length() > 0)
+			out.append("\n");
+		out.append(section_str.c_str(), section_str.length());
+	}
+	if (out.overflow())
+	{
+		ERR("failed: xorg.conf text does not fit the output buffer");
+		return false;
+	}
+	return true;
+}
+
+// Whole file into data, missing file is empty. False if it does not fit.
+static bool file_read(const char* path, char* data, size_t size, size_t& len, mode_t& mode)
+{
+	len = 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return true;
+		ERR("failed: open(): %s : %s", path, strerror(errno));
+		return false;
+	}
+	struct stat st{};
+	if (fstat(fd, &st) == 0)
+		mode = st.st_mode & 07777;
+	for (;;)
+	{
+		if (len == size)
+		{
+			ERR("failed: %s is over %zu bytes", path, size);
+			close(fd);
+			return false;
+		}
+		ssize_t rc = read(fd, data + len, size - len);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0)
+		{
+			ERR("failed: read(): %s : %s", path, strerror(errno));
+			close(fd);
+			return false;
+		}
+		if (rc == 0)
+			break;
+		len += rc;
+	}
+	close(fd);
+	return true;
+}
+
+static bool write_all(int fd, const char* data, size_t len)
+{
+	size_t done = 0;
+	while (done < len)
+	{
+		ssize_t rc = write(fd, data + done, len - done);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return false;
+		done += rc;
+	}
+	return true;
+}
+
+bool xorg_conf_update(const char* path, const xorg_conf_device_t* device_list, size_t count)
+{
+	// file and result on the stack, 2 * xorg_conf_max_size
+	xorg_conf_storage_t text;
+	size_t len = 0;
+	mode_t mode = 0644;
+	if (!file_read(path, text.data(), text.size(), len, mode))
+		return false;
+	xorg_conf_storage_t storage;
+	text_buf_t out(storage);
+	if (!xorg_conf_merge(text.data(), len, device_list, count, out))
+		return false;
+
+	// rename() replaces the file atomically only within one file system
+	std::array<char, PATH_MAX> tmp_path;
+	if (snprintf(tmp_path.data(), tmp_path.size(), "%s.XXXXXX", path) >= static_cast<int>(tmp_path.size()))
+	{
+		ERR("failed: path is too long: %s", path);
+		return false;
+	}
+	int fd = mkstemp(tmp_path.data());
+	if (fd < 0)
+	{
+		ERR("failed: mkstemp(): %s : %s", tmp_path.data(), strerror(errno));
+		return false;
+	}
+	if (fchmod(fd, mode) != 0 || !write_all(fd, out.c_str(), out.length()) || fsync(fd) != 0)
+	{
+		ERR("failed: write(): %s : %s", tmp_path.data(), strerror(errno));
+		close(fd);
+		unlink(tmp_path.data());
+		return false;
+	}
+	close(fd);
+	if (rename(tmp_path.data(), path) != 0)
+	{
+		ERR("failed: rename(): %s : %s", path, strerror(errno));
+		unlink(tmp_path.data());
+		return false;
+	}
+	// rename itself is durable after the directory is synced
+	std::array<char, PATH_MAX> dir;
+	const char* slash = strrchr(path, '/');
+	if (slash == nullptr)
+		strcpy(dir.data(), ".");
+	else if (slash == path)
+		strcpy(dir.data(), "/");
+	else
+		snprintf(dir.data(), dir.size(), "%.*s", static_cast<int>(slash - path), path);
+	int dir_fd = open(dir.data(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd >= 0)
+	{
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+	LOG("%s: %zu devices", path, count);
+	return true;
+}
@@ -0,0 +1,38 @@
+#ifndef XORG_CONF_H
+#define XORG_CONF_H
+
+// xorg.conf.d file with calibration of several devices.
+// Existing InputClass sections are matched by MatchProduct, only their
+// TransformationMatrix option is replaced, everything else in the file is kept.
+// Devices without a section get a new one appended.
+// Text is parsed in place and formatted into fixed storage, no heap allocation.
+
+#include "text_buf.h"
+#include "transform_matrix.h"
+
+#include <array>
+#include <cstddef>
+
+struct xorg_conf_device_t
+{
+	const char* name;
+	transform_matrix_t matrix;
+};
+
+constexpr size_t xorg_conf_max_devices = 16;   // devices of one update
+constexpr size_t xorg_conf_max_size = 64 * 1024;   // file before and after the update
+using xorg_conf_storage_t = std::array<char, xorg_conf_max_size>;
+
+// Appends text of len bytes with sections of the devices updated or appended to out.
+// Returns false if a device name is listed twice (e.g. same model on two seats),
+// there are more than xorg_conf_max_devices, a section does not fit the formatting
+// buffer (device name too long) or out is full.
+bool xorg_conf_merge(const char* text, size_t len, const xorg_conf_device_t* device_list, size_t count,
+	text_buf_t& out);
+
+// Merges into the file in one write: temp file in the same directory, fsync, rename.
+// Missing file is created, file over xorg_conf_max_size is refused.
+// On error the file is left untouched.
+bool xorg_conf_update(const char* path, const xorg_conf_device_t* device_list, size_t count);
+
+#endif  // XORG_CONF_H
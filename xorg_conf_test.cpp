@@ -0,0 +1,188 @@
+#include "xorg_conf.h"
+#include "xorgcal.h"
+#include "log.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string file_get(const std::string& path)
+{
+	std::string text;
+	FILE* fh = fopen(path.c_str(), "r");
+	ASSERT(fh != nullptr);
+	char buf[1024];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fh)) > 0)
+		text.append(buf, len);
+	fclose(fh);
+	return text;
+}
+
+void file_put(const std::string& path, const std::string& text)
+{
+	FILE* fh = fopen(path.c_str(), "w");
+	ASSERT(fh != nullptr);
+	ASSERT(fwrite(text.data(), 1, text.size(), fh) == text.size());
+	fclose(fh);
+}
+
+size_t count(const std::string& text, const std::string& str)
+{
+	size_t num = 0;
+	for (size_t pos = text.find(str); pos != std::string::npos; pos = text.find(str, pos + 1))
+		++num;
+	return num;
+}
+
+// xorg_conf_merge() of a string, out is replaced
+bool merge(const std::string& text, const std::vector<xorg_conf_device_t>& device_list, std::string& out)
+{
+	static xorg_conf_storage_t storage;
+	text_buf_t buf(storage);
+	bool rc = xorg_conf_merge(text.data(), text.size(), device_list.data(), device_list.size(), buf);
+	out = buf.c_str();
+	return rc;
+}
+
+const std::string identity_option = "\"1.000000 0.000000 0.000000 0.000000 1.000000 0.000000 0.000000 0.000000 1.000000\"";
+const std::string scaled_option = "\"2.000000 0.000000 0.000000 0.000000 1.000000 0.000000 0.000000 0.000000 1.000000\"";
+
+void merge_test()
+{
+	transform_matrix_t identity = transform_matrix_identity();
+	transform_matrix_t scaled = identity;
+	scaled[0] = 2;
+	std::string out;
+
+	// new file: one section per device
+	ASSERT(merge("", {{"panel A", identity}, {"panel B", scaled}}, out));
+	ASSERT(count(out, "Section \"InputClass\"") == 2);
+	ASSERT(count(out, "Identifier	\"calibration panel A\"") == 1);
+	ASSERT(count(out, "MatchProduct	\"panel B\"") == 1);
+	ASSERT(count(out, scaled_option) == 1);
+
+	// existing section: only the matrix option is replaced, foreign lines are kept
+	std::string existing =
+		"# calibration of the kiosk\n"
+		"Section \"InputClass\"\n"
+		"	Identifier \"calibration\"\n"
+		"	MatchProduct \"panel A\"\n"
+		"	option \"transformationmatrix\" \"1 0 0 0 1 0 0 0 1\"\n"
+		"	Option \"SwapAxes\" \"0\"\n"
+		"EndSection\n"
+		"\n"
+		"Section \"InputClass\"\n"
+		"	Identifier \"mouse\"\n"
+		"	MatchProduct \"USB Mouse\"\n"
+		"	Option \"TransformationMatrix\" \"1 0 0 0 1 0 0 0 1\"\n"
+		"EndSection";
+	ASSERT(merge(existing, {{"panel A", scaled}}, out));
+	ASSERT(count(out, "Section \"InputClass\"") == 2);
+	ASSERT(count(out, "# calibration of the kiosk\n") == 1);
+	ASSERT(count(out, "Option \"SwapAxes\" \"0\"") == 1);
+	ASSERT(count(out, scaled_option) == 1);
+	ASSERT(count(out, "\"1 0 0 0 1 0 0 0 1\"") == 1);   // mouse untouched
+	ASSERT(out.find(scaled_option) < out.find("SwapAxes"));   // in place of the old option
+
+	// second device appended, merge is idempotent
+	std::string merged;
+	std::string twice;
+	ASSERT(merge(out, {{"panel A", scaled}, {"panel B", identity}}, merged));
+	ASSERT(merge(merged, {{"panel A", scaled}, {"panel B", identity}}, twice));
+	ASSERT(merged == twice);
+	ASSERT(count(merged, "Section \"InputClass\"") == 3);
+	ASSERT(count(merged, identity_option) == 1);
+
+	// section without the option gets it before EndSection
+	ASSERT(merge("Section \"InputClass\"\n	MatchProduct \"panel B\"\nEndSection\n",
+		{{"panel B", scaled}}, out));
+	ASSERT(out.find(scaled_option) < out.find("EndSection"));
+	ASSERT(count(out, "Section \"InputClass\"") == 1);
+
+	// duplicate device in one batch: one matrix would be lost
+	ASSERT(!merge("", {{"panel A", identity}, {"panel B", identity}, {"panel A", scaled}}, out));
+
+	std::string long_name(4096, 'x');
+	ASSERT(!merge("", {{long_name.c_str(), identity}}, out));
+
+	// over xorg_conf_max_devices or over the output storage
+	std::vector<std::string> names(xorg_conf_max_devices + 1);
+	std::vector<xorg_conf_device_t> many;
+	for (size_t idx = 0; idx < names.size(); ++idx)
+	{
+		names[idx] = "panel " + std::to_string(idx);
+		many.push_back(xorg_conf_device_t{names[idx].c_str(), identity});
+	}
+	ASSERT(!merge("", many, out));
+	many.pop_back();
+	ASSERT(merge("", many, out));
+	ASSERT(count(out, "Section \"InputClass\"") == xorg_conf_max_devices);
+	std::array<char, 256> small;
+	text_buf_t small_buf(small);
+	ASSERT(!xorg_conf_merge("", 0, many.data(), many.size(), small_buf));
+}
+
+void update_test()
+{
+	char dir[] = "/tmp/xorg_conf_test.XXXXXX";
+	ASSERT(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/99-calibration.conf";
+
+	xorgcal_conf_device_t devices[2] = {
+		{"panel A", {2, 0, 0, 0, 1, 0, 0, 0, 1}},
+		{"panel B", {1, 0, 0, 0, 1, 0, 0, 0, 1}},
+	};
+	ASSERT(xorgcal_xorg_conf_update(path.c_str(), devices, 2) == XORGCAL_OK);
+	std::string text = file_get(path);
+	ASSERT(count(text, "Section \"InputClass\"") == 2);
+	struct stat st{};
+	ASSERT(stat(path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0644);
+
+	// mode of the existing file is kept, other content too
+	file_put(path, "# keep\n" + text);
+	ASSERT(chmod(path.c_str(), 0640) == 0);
+	devices[0].matrix[0] = 1;
+	ASSERT(xorgcal_xorg_conf_update(path.c_str(), devices, 1) == XORGCAL_OK);
+	text = file_get(path);
+	ASSERT(text.find("# keep\n") == 0);
+	ASSERT(count(text, identity_option) == 2 && count(text, scaled_option) == 0);
+	ASSERT(stat(path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0640);
+
+	// same model on two seats: refused, the file is not touched
+	xorgcal_conf_device_t seats[2] = {
+		{"panel A", {2, 0, 0, 0, 1, 0, 0, 0, 1}},
+		{"panel A", {1, 0, 0, 0, 1, 0, 0, 0, 1}},
+	};
+	ASSERT(xorgcal_xorg_conf_update(path.c_str(), seats, 2) == XORGCAL_ERROR);
+	ASSERT(file_get(path) == text);
+
+	// file over xorg_conf_max_size: refused, not truncated
+	std::string large = text + "# " + std::string(xorg_conf_max_size, 'x') + "\n";
+	file_put(path, large);
+	ASSERT(xorgcal_xorg_conf_update(path.c_str(), devices, 1) == XORGCAL_ERROR);
+	ASSERT(file_get(path) == large);
+	file_put(path, text);
+
+	// failed write leaves no temp file and the old file
+	xorgcal_conf_device_t bad{nullptr, {}};
+	ASSERT(xorgcal_xorg_conf_update(path.c_str(), &bad, 1) == XORGCAL_ERROR);
+	std::string missing_dir = std::string(dir) + "/missing/99-calibration.conf";
+	ASSERT(xorgcal_xorg_conf_update(missing_dir.c_str(), devices, 1) == XORGCAL_ERROR);
+	ASSERT(file_get(path) == text);
+
+	ASSERT(unlink(path.c_str()) == 0);
+	ASSERT(rmdir(dir) == 0);   // fails if a temp file was left behind
+}
+
+int main()
+{
+	merge_test();
+	update_test();
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,575 @@
+#include "xorgcal.h"
+#include "calibration.h"
+#include "calibration_quality.h"
+#include "control_server.h"
+#include "drift_monitor.h"
+#include "evdev_device.h"
+#include "input_profile.h"
+#include "screen_x11.h"
+#include "target_placement.h"
+#include "touch_device.h"
+#include "transform_matrix.h"
+#include "xorg_conf.h"
+#include "alloc_count.h"
+#include "log.h"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstring>
+
+bool verbose = false;
+
+struct xorgcal_session
+{
+	xorgcal_session(Display* display, int screen_num)
+	: scr(display, screen_num)
+	, message()
+	, timeout(0)
+	, max_error_px(0)
+	, retries(0)
+	, retry_message{
+		"Calibration is inaccurate",
+		"Press red cross center again",
+		"Any key to abort"
+		}
+	, evdev()
+	, quality_json()
+	, adaptive(false)
+	, tolerance_px(0)
+	, max_targets(0)
+	, grid(2)
+	, multitouch(false)
+	{}
+	~xorgcal_session()
+	{
+		evdev_close(evdev);
+	}
+
+	screen_x11_t scr;
+	std::vector<std::string> message;
+	int timeout;
+	double max_error_px;
+	int retries;
+	std::vector<std::string> retry_message;
+	evdev_device_t evdev;   // fd -1 - touches from X
+	// session run does not allocate, text is formatted here
+	quality_json_storage_t quality_json;
+	bool adaptive;
+	double tolerance_px;
+	size_t max_targets;
+	size_t grid;
+	bool multitouch;
+};
+
+
+static void copy_matrix(const transform_matrix_t& matr, float matrix[9])
+{
+	std::copy(matr.begin(), matr.end(), matrix);
+}
+
+static transform_matrix_t matrix_from_array(const float matrix[9])
+{
+	transform_matrix_t matr{};
+	std::copy(matrix, matrix + matr.size(), matr.begin());
+	return matr;
+}
+
+static void device_callback(const device_info_t& info, xorgcal_device_cb callback, void* user)
+{
+	xorgcal_device_t device{};
+	device.id = info.xid;
+	device.name = info.name.c_str();
+	device.calibratable = info.calibratable;
+	callback(&device, user);
+}
+
+static evdev_device_t* session_evdev(xorgcal_session_t* session)
+{
+	return session->evdev.fd >= 0 ? &session->evdev : nullptr;
+}
+
+// Solver gave NaN: the matrix is logged with the reason.
+static int session_invalid_matrix(const transform_matrix_t& matr)
+{
+	std::array<char, 256> storage;
+	text_buf_t matrix_str(storage);
+	transform_matrix_str(matr, matrix_str);
+	ERR("failed: transform_matrix_valid() transform_matrix: %s", matrix_str.c_str());
+	ERR("Probably there were misclicks");
+	return XORGCAL_INVALID_MATRIX;
+}
+
+static void session_quality_report(xorgcal_session_t* session, const touch_point_t* touch_point_list, size_t count,
+	const transform_matrix_t& matr, const xorgcal_callbacks_t* callbacks, void* user,
+	calibration_quality_t& quality)
+{
+	quality = calibration_quality(touch_point_list, count, matr, session->scr.width_, session->scr.height_);
+	text_buf_t json(session->quality_json);
+	if (!calibration_quality_json(quality, json))
+		ERR("quality report truncated");
+	LOG("quality: %s", json.c_str());
+	if (callbacks && callbacks->quality_report)
+		callbacks->quality_report(json.c_str(), user);
+}
+
+// Four fixed targets, 4-point solver.
+static int session_collect(xorgcal_session_t* session, const xorgcal_callbacks_t* callbacks, void* user,
+	transform_matrix_t& transform_matrix, calibration_quality_t& quality)
+{
+	screen_x11_t& scr = session->scr;
+	touch_point_list_t touch_point_list = touch_point_list_default(scr.width_, scr.height_);
+	if (!get_touch_point_list(scr, session_evdev(session), touch_point_list, session->timeout, callbacks, user))
+	{
+		ERR("Aborted");
+		return XORGCAL_ABORTED;
+	}
+
+	for (size_t idx = 0; idx < touch_point_list.size(); ++idx)
+		LOG("point: %d:%d\ttouch : %.2f:%.2f",
+			touch_point_list[idx].point.x, touch_point_list[idx].point.y,
+			touch_point_list[idx].touch.x, touch_point_list[idx].touch.y);
+
+	transform_matrix = ::transform_matrix(touch_point_list, scr.width_, scr.height_);
+	if (!transform_matrix_valid(transform_matrix))
+		return session_invalid_matrix(transform_matrix);
+	session_quality_report(session, touch_point_list.data(), touch_point_list.size(),
+		transform_matrix, callbacks, user, quality);
+	return XORGCAL_OK;
+}
+
+// Targets are added where the provisional fit is least certain until it is accurate enough.
+static int session_collect_adaptive(xorgcal_session_t* session, const xorgcal_callbacks_t* callbacks, void* user,
+	transform_matrix_t& transform_matrix, calibration_quality_t& quality)
+{
+	screen_x11_t& scr = session->scr;
+	target_placement_t placement(scr.width_, scr.height_, target_placement_t::max_grid,
+		session->tolerance_px, session->max_targets);
+	touch_point_t touch_point{};
+	touch_point_t prev{};
+	size_t idx = 0;
+	while (placement.next(touch_point.point))
+	{
+		if (!get_touch_point(scr, session_evdev(session), idx, touch_point,
+			idx > 0 ? &prev : nullptr, session->timeout, callbacks, user))
+		{
+			ERR("Aborted");
+			return XORGCAL_ABORTED;
+		}
+		if (!placement.add(touch_point.touch))
+			return session_invalid_matrix(placement.matrix_);
+		if (placement.solved_)
+			session_quality_report(session, placement.touch_point_list_.data(), placement.count_,
+				placement.matrix_, callbacks, user, quality);
+		prev = touch_point;
+		++idx;
+	}
+	draw_touch_point(scr, prev.point, WHITE);
+	transform_matrix = placement.matrix_;
+	return XORGCAL_OK;
+}
+
+// grid x grid targets one by one, or all at once with multitouch, least squares fit.
+static int session_collect_grid(xorgcal_session_t* session, const xorgcal_callbacks_t* callbacks, void* user,
+	transform_matrix_t& transform_matrix, calibration_quality_t& quality)
+{
+	screen_x11_t& scr = session->scr;
+	std::array<xy_t, max_touch_points> target{};
+	size_t count = target_grid(scr.width_, scr.height_, session->grid, target.data(), target.size());
+	std::array<touch_point_t, max_touch_points> touch_point_list{};
+	for (size_t idx = 0; idx < count; ++idx)
+		touch_point_list[idx].point = target[idx];
+
+	bool touched = true;
+	// evdev touches have no ids, targets one by one then
+	if (session->multitouch && session_evdev(session) == nullptr)
+	{
+		// UL, UR and LL corners one by one first: their fit maps the rest of the touches
+		// to the screen before matching, raw touches of a mirrored or rotated panel
+		// are nearest to the wrong targets
+		constexpr size_t reference_count = 3;
+		std::swap(touch_point_list[1], touch_point_list[session->grid - 1]);
+		std::swap(touch_point_list[2], touch_point_list[session->grid * (session->grid - 1)]);
+		for (size_t idx = 0; idx < reference_count && touched; ++idx)
+			touched = get_touch_point(scr, nullptr, idx, touch_point_list[idx],
+				idx > 0 ? &touch_point_list[idx - 1] : nullptr, session->timeout, callbacks, user);
+		if (!touched)
+		{
+			ERR("Aborted");
+			return XORGCAL_ABORTED;
+		}
+		draw_touch_point(scr, touch_point_list[reference_count - 1].point, WHITE);
+		transform_matrix_t provisional = transform_matrix_lsq(touch_point_list.data(), reference_count,
+			scr.width_, scr.height_);
+		if (!transform_matrix_valid(provisional))
+		{
+			ERR("failed: transform_matrix_valid() of reference targets, probably a misclick");
+			return XORGCAL_INVALID_MATRIX;
+		}
+		touched = get_touch_points_parallel(scr, touch_point_list.data(), reference_count, count,
+			provisional, session->timeout, callbacks, user);
+	}
+	else
+	{
+		for (size_t idx = 0; idx < count && touched; ++idx)
+			touched = get_touch_point(scr, session_evdev(session), idx, touch_point_list[idx],
+				idx > 0 ? &touch_point_list[idx - 1] : nullptr, session->timeout, callbacks, user);
+		if (touched)
+			draw_touch_point(scr, touch_point_list[count - 1].point, WHITE);
+	}
+	if (!touched)
+	{
+		ERR("Aborted");
+		return XORGCAL_ABORTED;
+	}
+
+	for (size_t idx = 0; idx < count; ++idx)
+		LOG("point: %d:%d\ttouch : %.2f:%.2f",
+			touch_point_list[idx].point.x, touch_point_list[idx].point.y,
+			touch_point_list[idx].touch.x, touch_point_list[idx].touch.y);
+
+	transform_matrix = transform_matrix_lsq(touch_point_list.data(), count, scr.width_, scr.height_);
+	if (!transform_matrix_valid(transform_matrix))
+		return session_invalid_matrix(transform_matrix);
+	session_quality_report(session, touch_point_list.data(), count,
+		transform_matrix, callbacks, user, quality);
+	return XORGCAL_OK;
+}
+
+// Exceptions (std::bad_alloc etc.) shall not cross the C API.
+template <typename F>
+static auto c_call(const char* name, decltype(std::declval<F>()()) error, F func) -> decltype(func())
+{
+	try
+	{
+		return func();
+	}
+	catch (const std::exception& exception)
+	{
+		ERR("failed: %s(): %s", name, exception.what());
+	}
+	catch (...)
+	{
+		ERR("failed: %s(): unknown exception", name);
+	}
+	return error;
+}
+
+// Copy of the caller struct of its own size: fields past it keep the value of
+// out (defaults), fields unknown to this library are ignored. NULL - defaults.
+template <typename T>
+static bool struct_get(const T* in, T& out)
+{
+	if (in == nullptr)
+		return true;
+	if (in->size < sizeof(in->size))
+	{
+		ERR("failed: struct size %zu, not initialized with xorgcal_*_init()", in->size);
+		return false;
+	}
+	memcpy(static_cast<void*>(&out), in, std::min(in->size, sizeof(T)));
+	out.size = sizeof(T);
+	return true;
+}
+
+template <typename T>
+static void struct_init(T* out, const T& defaults, size_t size)
+{
+	if (out == nullptr || size < sizeof(out->size))
+		return;
+	memset(static_cast<void*>(out), 0, size);
+	memcpy(static_cast<void*>(out), &defaults, std::min(size, sizeof(T)));
+	out->size = size;
+}
+
+static xorgcal_options_t options_default()
+{
+	xorgcal_options_t options{};
+	options.size = sizeof(options);
+	options.screen_num = invalid_screen_num;
+	options.retries = 3;
+	options.tolerance_px = 2;
+	options.max_targets = 13;
+	options.grid = 2;
+	return options;
+}
+
+extern "C" {
+
+void xorgcal_set_verbose(int enable)
+{
+	verbose = enable != 0;
+}
+
+void xorgcal_options_init_size(xorgcal_options_t* options, size_t size)
+{
+	struct_init(options, options_default(), size);
+}
+
+void xorgcal_callbacks_init_size(xorgcal_callbacks_t* callbacks, size_t size)
+{
+	xorgcal_callbacks_t defaults{};
+	defaults.size = sizeof(defaults);
+	struct_init(callbacks, defaults, size);
+}
+
+int xorgcal_device_list(Display* display, xorgcal_device_cb callback, void* user)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display == nullptr || callback == nullptr)
+			return XORGCAL_ERROR;
+		for (const auto& info : device_info_list_get(display))
+			device_callback(info, callback, user);
+		return XORGCAL_OK;
+	});
+}
+
+int xorgcal_device_select(Display* display, const char* device_name, int device_id,
+	xorgcal_device_cb callback, void* user)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display == nullptr || callback == nullptr)
+			return XORGCAL_ERROR;
+		device_info_list_t dev_info_list = device_info_list_get(display);
+		if (dev_info_list.empty())
+		{
+			ERR("Error: No devices found.");
+			return XORGCAL_NO_DEVICE;
+		}
+		device_info_t device_info = select_device(dev_info_list,
+			device_name ? device_name : "", device_id);
+		if (!device_info.calibratable)
+		{
+			ERR("Error: No calibratable devices found.");
+			return XORGCAL_NO_DEVICE;
+		}
+		device_callback(device_info, callback, user);
+		return XORGCAL_OK;
+	});
+}
+
+int xorgcal_set_matrix(Display* display, int device_id, const float matrix[9])
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display == nullptr || matrix == nullptr)
+			return XORGCAL_ERROR;
+		return set_matrix(display, device_id, matrix_from_array(matrix)) ? XORGCAL_OK : XORGCAL_ERROR;
+	});
+}
+
+int xorgcal_reset(Display* display, int device_id)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display == nullptr)
+			return XORGCAL_ERROR;
+		return reset_calibration(display, device_id) ? XORGCAL_OK : XORGCAL_ERROR;
+	});
+}
+
+xorgcal_session_t* xorgcal_session_new(Display* display, const xorgcal_options_t* options)
+{
+	return c_call(__func__, static_cast<xorgcal_session_t*>(nullptr), [&]() -> xorgcal_session_t* {
+		xorgcal_options_t caller_options = options_default();
+		if (display == nullptr || !struct_get(options, caller_options))
+			return nullptr;
+		options = &caller_options;
+		std::unique_ptr<xorgcal_session_t> session(new xorgcal_session_t(display, options->screen_num));
+		if (!session->scr.is_valid)
+			return nullptr;
+		LOG("scr.width_:%d scr.height_:%d", session->scr.width_, session->scr.height_);
+		session->timeout = options->timeout;
+		session->max_error_px = options->max_error_px;
+		session->retries = std::max(options->retries, 0);
+		session->adaptive = options->adaptive != 0;
+		session->tolerance_px = options->tolerance_px;
+		session->max_targets = std::min(std::max(options->max_targets, 4), 25);
+		session->grid = std::min(std::max<size_t>(std::max(options->grid, 0), 2), target_placement_t::max_grid);
+		// adaptive placement shows one target at a time
+		if (options->multitouch != 0 && !session->adaptive)
+		{
+			session->multitouch = session->scr.touch_select();
+			if (!session->multitouch)
+				ERR("Warning: no multi-touch events, targets are shown one by one");
+		}
+		if (options->message != nullptr)
+			session->message.assign(options->message, options->message + options->message_lines);
+		else
+			session->message = {
+				"Touchscreen calibration",
+				"Press red cross center",
+				"Any key to abort"
+				};
+		return session.release();
+	});
+}
+
+int xorgcal_session_evdev(xorgcal_session_t* session, int device_id, const char* node)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (session == nullptr)
+			return XORGCAL_ERROR;
+		std::string path = node ? node : device_node_get(session->scr.display_, device_id);
+		if (path.empty())
+			return XORGCAL_ERROR;
+		evdev_close(session->evdev);
+		return evdev_open(path, session->evdev) ? XORGCAL_OK : XORGCAL_ERROR;
+	});
+}
+
+int xorgcal_session_run(xorgcal_session_t* session,
+	const xorgcal_callbacks_t* callbacks, void* user, float matrix[9])
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		xorgcal_callbacks_t caller_callbacks{};
+		if (session == nullptr || matrix == nullptr || !struct_get(callbacks, caller_callbacks))
+			return XORGCAL_ERROR;
+		callbacks = &caller_callbacks;
+#ifdef XORGCAL_COUNT_ALLOC
+		alloc_report_t alloc_report("session run");
+#endif
+		screen_x11_t& scr = session->scr;
+		draw_message(scr, session->message);
+
+		transform_matrix_t transform_matrix{};
+		for (int attempt = 0; ; ++attempt)
+		{
+			calibration_quality_t quality{};
+			int rc = session->adaptive ?
+				session_collect_adaptive(session, callbacks, user, transform_matrix, quality) :
+				session->grid > 2 || session->multitouch ?
+				session_collect_grid(session, callbacks, user, transform_matrix, quality) :
+				session_collect(session, callbacks, user, transform_matrix, quality);
+			if (rc != XORGCAL_OK)
+				return rc;
+
+			if (session->max_error_px <= 0 || quality.max_px <= session->max_error_px)
+				break;
+			ERR("max error %f px is over %f px", quality.max_px, session->max_error_px);
+			if (attempt >= session->retries)
+				return XORGCAL_INACCURATE;
+			scr.clear();
+			draw_message(scr, session->retry_message);
+		}
+
+		copy_matrix(transform_matrix, matrix);
+		if (callbacks && callbacks->matrix_computed)
+			callbacks->matrix_computed(matrix, user);
+		return XORGCAL_OK;
+	});
+}
+
+void xorgcal_session_free(xorgcal_session_t* session)
+{
+	delete session;
+}
+
+int xorgcal_drift_monitor(Display* display, int device_id, const char* socket_path, double threshold_px)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display == nullptr || socket_path == nullptr)
+			return XORGCAL_ERROR;
+		drift_config_t config{};
+		config.threshold_px = threshold_px;
+		drift_monitor_run(display, device_id, socket_path, config);
+		return XORGCAL_ERROR;
+	});
+}
+
+int xorgcal_control_server(Display* display, const char* socket_path, const xorgcal_options_t* options)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		xorgcal_options_t caller_options = options_default();
+		if (display == nullptr || socket_path == nullptr || !struct_get(options, caller_options))
+			return XORGCAL_ERROR;
+		control_server_run(display, socket_path, caller_options);
+		return XORGCAL_ERROR;
+	});
+}
+
+int xorgcal_input_profile(Display* display, int device_id, double window_s,
+	xorgcal_text_cb callback, void* user)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display == nullptr || callback == nullptr || window_s <= 0)
+			return XORGCAL_ERROR;
+		input_profile_t profile{};
+		for (const auto& info : device_info_list_get(display))
+			if (static_cast<int>(info.xid) == device_id)
+				profile.device_name = info.name;
+		if (!input_profile_capture(display, device_id, window_s, profile))
+			return XORGCAL_ERROR;
+		input_profile_json_storage_t storage;
+		text_buf_t json(storage);
+		if (!input_profile_json(profile, json))
+		{
+			ERR("failed: input_profile_json(): report truncated");
+			return XORGCAL_ERROR;
+		}
+		callback(json.c_str(), user);
+		return XORGCAL_OK;
+	});
+}
+
+int xorgcal_xorg_conf(const float matrix[9], const char* device_name,
+	xorgcal_text_cb callback, void* user)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (matrix == nullptr || device_name == nullptr || callback == nullptr)
+			return XORGCAL_ERROR;
+		std::array<char, 2048> storage;
+		text_buf_t outstr(storage);
+		if (!xorg_str(matrix_from_array(matrix), device_name, outstr))
+		{
+			ERR("failed: xorg_str(): device name is too long");
+			return XORGCAL_ERROR;
+		}
+		callback(outstr.c_str(), user);
+		return XORGCAL_OK;
+	});
+}
+
+int xorgcal_seat_report(const char* display_name, const char* device_name, int ok,
+	const float matrix[9], const char* attempts, char* out, size_t size)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (display_name == nullptr || device_name == nullptr || matrix == nullptr ||
+			attempts == nullptr || out == nullptr || size == 0)
+			return XORGCAL_ERROR;
+		size_t len = strnlen(out, size - 1);
+		text_buf_t outstr(out + len, size - len);
+		if (!seat_report_json(display_name, device_name, ok != 0, matrix_from_array(matrix), attempts, outstr))
+		{
+			ERR("failed: seat report does not fit %zu bytes", size);
+			return XORGCAL_ERROR;
+		}
+		return XORGCAL_OK;
+	});
+}
+
+int xorgcal_xorg_conf_update(const char* path, const xorgcal_conf_device_t* devices, size_t count)
+{
+	return c_call(__func__, XORGCAL_ERROR, [&]() -> int {
+		if (path == nullptr || (devices == nullptr && count > 0))
+			return XORGCAL_ERROR;
+		if (count > xorg_conf_max_devices)
+		{
+			ERR("failed: %zu devices, at most %zu in one update", count, xorg_conf_max_devices);
+			return XORGCAL_ERROR;
+		}
+		std::array<xorg_conf_device_t, xorg_conf_max_devices> device_list;
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			if (devices[idx].name == nullptr)
+				return XORGCAL_ERROR;
+			device_list[idx] = xorg_conf_device_t{devices[idx].name, matrix_from_array(devices[idx].matrix)};
+		}
+		return xorg_conf_update(path, device_list.data(), count) ? XORGCAL_OK : XORGCAL_ERROR;
+	});
+}
+
+}  // extern "C"
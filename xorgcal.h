@@ -0,0 +1,164 @@
+#ifndef XORGCAL_H
+#define XORGCAL_H
+
+/*
+ * libxorgcal - touch screen calibration library.
+ *
+ * All functions take an existing X connection owned by the caller.
+ * Results are delivered through callbacks, strings passed to callbacks
+ * are valid only during the call.
+ * Option and callback structures only grow at the end and start with the
+ * struct size the caller was built with: initialize them with xorgcal_options_init()
+ * / xorgcal_callbacks_init() before setting fields. The library reads only the
+ * fields within that size, the rest keep defaults. Size 0 is rejected.
+ */
+
+#include <X11/Xlib.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum xorgcal_status
+{
+	XORGCAL_OK = 0,
+	XORGCAL_ERROR = -1,            /* X or argument error */
+	XORGCAL_NO_DEVICE = -2,        /* no calibratable device found */
+	XORGCAL_ABORTED = -3,          /* key pressed or timeout */
+	XORGCAL_INVALID_MATRIX = -4,   /* probably there were misclicks */
+	XORGCAL_INACCURATE = -5,       /* error above max_error_px after all retries */
+};
+
+typedef struct xorgcal_device
+{
+	int id;
+	const char* name;
+	int calibratable;
+} xorgcal_device_t;
+
+typedef void (*xorgcal_device_cb)(const xorgcal_device_t* device, void* user);
+typedef void (*xorgcal_text_cb)(const char* text, void* user);
+
+typedef struct xorgcal_options
+{
+	size_t size;                     /* sizeof(xorgcal_options_t) of the caller, set by init */
+	int screen_num;                  /* -1 - default screen */
+	const char* const* message;      /* lines shown in the center, NULL - default */
+	size_t message_lines;
+	int timeout;                     /* seconds to wait for each touch, 0 - forever */
+	double max_error_px;             /* re-prompt if any target residual is larger, 0 - off */
+	int retries;                     /* re-prompts before XORGCAL_INACCURATE */
+	int adaptive;                    /* targets placed where the fit is least certain, least squares fit */
+	double tolerance_px;             /* adaptive: stop when leave-one-out RMS error is below */
+	int max_targets;                 /* adaptive: stop after this many targets, 4..25 */
+	int grid;                        /* grid x grid targets, 2..5, above 2 least squares fit */
+	int multitouch;                  /* all grid targets at once, touches matched by XI 2.2 touch id */
+} xorgcal_options_t;
+
+typedef struct xorgcal_callbacks
+{
+	size_t size;                     /* sizeof(xorgcal_callbacks_t) of the caller, set by init */
+	/* target index drawn at screen position x:y */
+	void (*target_shown)(int index, int x, int y, void* user);
+	/* touch accepted for the target index */
+	void (*sample_accepted)(int index, int x, int y, void* user);
+	/* calibration matrix computed, not applied yet */
+	void (*matrix_computed)(const float matrix[9], void* user);
+	/* quality report JSON of every solve: per target residual and leave-one-out
+	 * prediction error in pixels, RMS/max and condition number */
+	void (*quality_report)(const char* json, void* user);
+} xorgcal_callbacks_t;
+
+typedef struct xorgcal_session xorgcal_session_t;
+
+void xorgcal_set_verbose(int verbose);
+/* Defaults, callbacks NULL. size - sizeof of the struct, use the macros. */
+void xorgcal_options_init_size(xorgcal_options_t* options, size_t size);
+void xorgcal_callbacks_init_size(xorgcal_callbacks_t* callbacks, size_t size);
+#define xorgcal_options_init(options) xorgcal_options_init_size((options), sizeof(xorgcal_options_t))
+#define xorgcal_callbacks_init(callbacks) xorgcal_callbacks_init_size((callbacks), sizeof(xorgcal_callbacks_t))
+
+/* Calls callback for every input device except virtual master devices. */
+int xorgcal_device_list(Display* display, xorgcal_device_cb callback, void* user);
+/* Device by name or id (-1 - any), else the last calibratable device. */
+int xorgcal_device_select(Display* display, const char* device_name, int device_id,
+	xorgcal_device_cb callback, void* user);
+
+int xorgcal_set_matrix(Display* display, int device_id, const float matrix[9]);
+/* Sets identity matrix, shall be done before session run. */
+int xorgcal_reset(Display* display, int device_id);
+
+/* Creates, maps and grabs full screen calibration window. */
+xorgcal_session_t* xorgcal_session_new(Display* display, const xorgcal_options_t* options);
+/*
+ * Session reads touches directly from the kernel evdev node instead of X events,
+ * absolute axes mapped through their range, X is still used for drawing and keys.
+ * node NULL - "Device Node" property of device_id. Needs read access to the node.
+ */
+int xorgcal_session_evdev(xorgcal_session_t* session, int device_id, const char* node);
+/* Shows targets, collects touches and computes matrix into matrix[9]. */
+int xorgcal_session_run(xorgcal_session_t* session,
+	const xorgcal_callbacks_t* callbacks, void* user, float matrix[9]);
+void xorgcal_session_free(xorgcal_session_t* session);
+
+/*
+ * Drift monitor: application sends "target_x target_y event_x event_y" datagrams
+ * (hit target center and the tap position it got, screen pixels) to unix socket,
+ * matrix is re-estimated online and set to the device when any screen corner
+ * moves more than threshold_px. Returns only on error.
+ */
+int xorgcal_drift_monitor(Display* display, int device_id, const char* socket_path, double threshold_px);
+
+/*
+ * Control server: requests (list, reset, apply, calibrate) and progress events as
+ * length prefixed messages on unix stream socket, see control_server.h for the protocol.
+ * options are defaults of calibrate requests. The X connection and device list
+ * are kept across requests. Returns only on error.
+ */
+int xorgcal_control_server(Display* display, const char* socket_path, const xorgcal_options_t* options);
+
+/*
+ * Input latency profile: XI2 raw and cooked events of the device are captured for
+ * window_s seconds, server event time is compared with the receive time on CLOCK_MONOTONIC.
+ * callback gets JSON report: per stream event rate, latency percentiles, jitter and
+ * coalescing, see input_profile.h. Latency is meaningful only for a local X server.
+ */
+int xorgcal_input_profile(Display* display, int device_id, double window_s,
+	xorgcal_text_cb callback, void* user);
+
+/* xorg.conf InputClass section with Option "TransformationMatrix". */
+int xorgcal_xorg_conf(const float matrix[9], const char* device_name,
+	xorgcal_text_cb callback, void* user);
+
+/*
+ * Seat entry of a multiseat JSON report: display, device, ok, matrix and attempts -
+ * the quality_report JSON lines of the seat as an array. Appended to the NUL
+ * terminated text in out of size bytes, no heap allocation.
+ * XORGCAL_ERROR if it does not fit, out then holds the truncated text.
+ */
+int xorgcal_seat_report(const char* display_name, const char* device_name, int ok,
+	const float matrix[9], const char* attempts, char* out, size_t size);
+
+typedef struct xorgcal_conf_device
+{
+	const char* name;
+	float matrix[9];
+} xorgcal_conf_device_t;
+
+/*
+ * Updates xorg.conf.d file at path with matrices of all devices in one write.
+ * Sections are matched by MatchProduct, only their TransformationMatrix option
+ * is replaced, missing sections are appended, the rest of the file is kept.
+ * Device names shall be unique, else XORGCAL_ERROR and the file is not touched.
+ * Up to 16 devices and 64 KiB of file, no heap allocation.
+ * Written to a temp file, fsync and renamed: the file is either old or new.
+ */
+int xorgcal_xorg_conf_update(const char* path, const xorgcal_conf_device_t* devices, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* XORGCAL_H */